@@ -3,329 +3,5976 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <cmath>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <limits>
+#include <sstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include <new>
+#include <array>
+#include <map>
+#include <random>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define ELEVATOR_HAS_EPOLL 1
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define ELEVATOR_HAS_AVX2_KERNEL 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ELEVATOR_HAS_NEON_KERNEL 1
+#endif
 using namespace std;
 
+// Simulated time in milliseconds
+using SimTime = long long;
+
+// Timing model for a single car
+const SimTime FLOOR_TRAVEL_TIME = 2000;
+const SimTime DOOR_DWELL_TIME = 3000;
+
+// Building height, fixed at compile time so per-car stop sets need no allocation
+#ifndef ELEVATOR_MAX_FLOORS
+#define ELEVATOR_MAX_FLOORS 128
+#endif
+const int MAX_FLOORS = ELEVATOR_MAX_FLOORS;
+
+// Returned by floor lookups that find nothing
+const int NO_FLOOR = -1;
+
+inline int lowestSetBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+inline int highestSetBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(word);
+#else
+    int bit = 63;
+    while (!(word >> 63)) { word <<= 1; bit--; }
+    return bit;
+#endif
+}
+
+inline int countSetBits(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int bits = 0;
+    for (; word; word &= word - 1) bits++;
+    return bits;
+#endif
+}
+
+// Logging
+enum class LogLevel { TRACE, DEBUG, INFO, WARN, ERROR, OFF };
+
+// Statements below this level are compiled out entirely; build with
+// -DELEVATOR_LOG_LEVEL=5 for headless runs that should do no logging work at all
+#ifndef ELEVATOR_LOG_LEVEL
+#define ELEVATOR_LOG_LEVEL 0
+#endif
+
+class LogSink {
+public:
+    virtual void write(LogLevel level, const string& message) = 0;
+    virtual ~LogSink() = default;
+};
+
+class ConsoleLogSink : public LogSink {
+private:
+    mutex outputLock;
+
+public:
+    void write(LogLevel, const string& message) override {
+        lock_guard<mutex> guard(outputLock);
+        cout << message << "\n";
+    }
+};
+
+class NullLogSink : public LogSink {
+public:
+    void write(LogLevel, const string&) override {}
+};
+
+// Hands messages to a background thread through a fixed-size ring so callers never
+// block on I/O; when the ring is full new messages are dropped and counted
+class AsyncLogSink : public LogSink {
+private:
+    struct Entry {
+        LogLevel level;
+        string message;
+    };
+
+    LogSink& target;
+    vector<Entry> ring;
+    size_t head;     // Next entry to write out
+    size_t count;    // Entries waiting in the ring
+    bool writing;    // Writer thread holds an entry outside the ring
+    bool stopping;
+    atomic<size_t> dropped;
+    mutex ringLock;
+    condition_variable pending;
+    condition_variable drained;
+    thread writer;
+
+    void drain() {
+        unique_lock<mutex> guard(ringLock);
+        while (true) {
+            pending.wait(guard, [this] { return count > 0 || stopping; });
+            if (count == 0) break;
+            Entry entry = std::move(ring[head]);
+            head = (head + 1) % ring.size();
+            count--;
+            writing = true;
+            guard.unlock();
+            target.write(entry.level, entry.message);
+            guard.lock();
+            writing = false;
+            if (count == 0) drained.notify_all();
+        }
+    }
+
+public:
+    explicit AsyncLogSink(LogSink& target, size_t capacity = 4096)
+        : target(target), ring(capacity), head(0), count(0), writing(false), stopping(false),
+          dropped(0), writer(&AsyncLogSink::drain, this) {}
+
+    ~AsyncLogSink() {
+        {
+            lock_guard<mutex> guard(ringLock);
+            stopping = true;
+        }
+        pending.notify_one();
+        writer.join();
+    }
+
+    void write(LogLevel level, const string& message) override {
+        {
+            lock_guard<mutex> guard(ringLock);
+            if (count == ring.size()) {
+                dropped++;
+                return;
+            }
+            Entry& slot = ring[(head + count) % ring.size()];
+            slot.level = level;
+            slot.message = message;
+            count++;
+        }
+        pending.notify_one();
+    }
+
+    // Blocks until every accepted message has reached the target sink
+    void flush() {
+        unique_lock<mutex> guard(ringLock);
+        drained.wait(guard, [this] { return count == 0 && !writing; });
+    }
+
+    size_t getDroppedCount() const { return dropped.load(); }
+};
+
+class Logger {
+private:
+    static LogSink& consoleSink() {
+        static ConsoleLogSink console;
+        return console;
+    }
+
+    static atomic<LogSink*>& sink() {
+        static atomic<LogSink*> current(&consoleSink());
+        return current;
+    }
+
+    static atomic<int>& level() {
+        static atomic<int> current(static_cast<int>(LogLevel::DEBUG));
+        return current;
+    }
+
+public:
+    // Passing nullptr restores the console sink
+    static void setSink(LogSink* newSink) { sink().store(newSink ? newSink : &consoleSink()); }
+
+    static void setLevel(LogLevel newLevel) { level().store(static_cast<int>(newLevel)); }
+
+    static bool isEnabled(LogLevel messageLevel) {
+        return static_cast<int>(messageLevel) >= level().load(memory_order_relaxed);
+    }
+
+    static void write(LogLevel messageLevel, const string& message) {
+        sink().load()->write(messageLevel, message);
+    }
+};
+
+// The message is only formatted when its level is enabled
+#define ELEVATOR_LOG(level, message)                                                     \
+    do {                                                                                 \
+        if (static_cast<int>(level) >= ELEVATOR_LOG_LEVEL && Logger::isEnabled(level)) { \
+            ostringstream logStream;                                                     \
+            logStream << message;                                                        \
+            Logger::write(level, logStream.str());                                       \
+        }                                                                                \
+    } while (0)
+
+#define LOG_TRACE(message) ELEVATOR_LOG(LogLevel::TRACE, message)
+#define LOG_DEBUG(message) ELEVATOR_LOG(LogLevel::DEBUG, message)
+#define LOG_INFO(message) ELEVATOR_LOG(LogLevel::INFO, message)
+#define LOG_WARN(message) ELEVATOR_LOG(LogLevel::WARN, message)
+
 // Forward declarations
 class Elevator;
 class ElevatorManager;
 class OuterPanel;
+class InnerPanel;
+struct HallCall;
 
 // Enums
 enum class Direction { UP, DOWN };
-enum class StateType { IDLE, MOVING_UP, MOVING_DOWN }; 
+enum class StateType { IDLE, MOVING_UP, MOVING_DOWN, OUT_OF_SERVICE }; 
+const size_t STATE_TYPE_COUNT = 4;
+enum class EventType { HALL_CALL, FLOOR_ARRIVAL, DOOR_OPEN, DOOR_CLOSE };
 
 string getStateName(StateType state) {
     switch(state) {
         case StateType::IDLE: return "IDLE";
         case StateType::MOVING_UP: return "MOVING_UP";
         case StateType::MOVING_DOWN: return "MOVING_DOWN";
+        case StateType::OUT_OF_SERVICE: return "OUT_OF_SERVICE";
         default: return "UNKNOWN";
     }
 }
 
-// Observer Interface
-class ElevatorObserver {
-public:
-    virtual void update(int floor, StateType state) = 0;
-    virtual ~ElevatorObserver() = default;
-};
+// Metrics
+// Hot-path counters and latency histograms. Build with -DELEVATOR_METRICS=0 to
+// compile every recording site, the storage and the export out.
+#ifndef ELEVATOR_METRICS
+#define ELEVATOR_METRICS 1
+#endif
 
-// State Pattern
-class State {
-protected:
-    Elevator* elevator;
+#if ELEVATOR_METRICS
+#define ELEVATOR_METRIC(statement) do { statement; } while (0)
+#define ELEVATOR_METRIC_TIMER(name, histogram, calls) ScopedLatencyTimer name(histogram, calls)
+#else
+#define ELEVATOR_METRIC(statement) do {} while (0)
+#define ELEVATOR_METRIC_TIMER(name, histogram, calls) do {} while (0)
+#endif
 
-public:
-    explicit State(Elevator* e) : elevator(e) {}
-    virtual void moveUp() = 0;
-    virtual void moveDown() = 0;
-    virtual void stop() = 0;
-    virtual StateType getType() = 0;
-    virtual ~State() = default;
+#if ELEVATOR_METRICS
+struct HistogramSnapshot {
+    uint64_t count;
+    long long sum;
+    long long p50;
+    long long p90;
+    long long p99;
+    long long max;
 };
 
-// Forward declare concrete states
-class IdleState;
-class MovingUpState;
-class MovingDownState;
-
-// Core Elevator Class
-class Elevator {
+// HDR-style histogram: 16 linear sub-buckets per power of two, so every value in
+// [0, 2^40] is reported within 1/16 of itself. Recording is a few relaxed atomic
+// operations, safe from every car's handler under runParallel.
+class LatencyHistogram {
 private:
-    int id;
-    int currentFloor;
-    State* state;
-    queue<int> floorQueue;
-    ElevatorManager* manager;
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 40;
+    static const int BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    array<atomic<uint64_t>, BUCKETS> counts;
+    atomic<uint64_t> total;
+    atomic<long long> sum;
+    atomic<long long> maxValue;
+
+    static int bucketFor(uint64_t value) {
+        if (value < static_cast<uint64_t>(SUB_BUCKETS)) return static_cast<int>(value);
+        int exponent = min(highestSetBit(value), MAX_EXPONENT);
+        int shift = exponent - SUB_BUCKET_BITS;
+        int sub = static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+        if (highestSetBit(value) > MAX_EXPONENT) sub = SUB_BUCKETS - 1;
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    // Largest value that lands in the bucket
+    static long long bucketUpperBound(int bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int shift = bucket / SUB_BUCKETS - 1;
+        long long lower = static_cast<long long>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+        return lower + (1LL << shift) - 1;
+    }
 
 public:
-    Elevator(int id, ElevatorManager* mgr);
-    ~Elevator() { delete state; }
+    LatencyHistogram() : total(0), sum(0), maxValue(0) {
+        for (atomic<uint64_t>& bucket : counts) bucket.store(0, memory_order_relaxed);
+    }
 
-    void setState(State* newState);
-    void addToQueue(int floor);
-    void processQueue();
-    void simulateMovement(int targetFloor);
-    
-    int getCurrentFloor() const { return currentFloor; }
-    int getId() const { return id; }
-    State* getState() const { return state; }
+    // Adds `times` samples of `value`; negative values count as zero
+    void record(long long value, uint64_t times = 1) {
+        if (value < 0) value = 0;
+        counts[static_cast<size_t>(bucketFor(static_cast<uint64_t>(value)))].fetch_add(times, memory_order_relaxed);
+        total.fetch_add(times, memory_order_relaxed);
+        sum.fetch_add(value * static_cast<long long>(times), memory_order_relaxed);
+        long long seen = maxValue.load(memory_order_relaxed);
+        while (value > seen && !maxValue.compare_exchange_weak(seen, value, memory_order_relaxed)) {}
+    }
+
+    uint64_t getCount() const { return total.load(memory_order_relaxed); }
+
+    // Smallest bucket bound with at least `quantile` of the samples at or below it
+    long long percentile(double quantile) const {
+        uint64_t count = getCount();
+        if (count == 0) return 0;
+        uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(quantile * static_cast<double>(count))));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKETS; bucket++) {
+            seen += counts[static_cast<size_t>(bucket)].load(memory_order_relaxed);
+            if (seen >= rank) return min(bucketUpperBound(bucket), maxValue.load(memory_order_relaxed));
+        }
+        return maxValue.load(memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const {
+        return HistogramSnapshot{getCount(), sum.load(memory_order_relaxed), percentile(0.5),
+                                 percentile(0.9), percentile(0.99), maxValue.load(memory_order_relaxed)};
+    }
 };
 
-// Strategy Pattern
-class ElevatorSelectionStrategy {
+// C++14 needs a definition once a constant is bound to a reference, as min does
+const int LatencyHistogram::MAX_EXPONENT;
+
+// Records wall-clock nanoseconds per call for the enclosing scope
+class ScopedLatencyTimer {
+private:
+    LatencyHistogram& histogram;
+    uint64_t calls;
+    chrono::steady_clock::time_point started;
+
 public:
-    virtual Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) = 0;
-    virtual ~ElevatorSelectionStrategy() = default;
+    ScopedLatencyTimer(LatencyHistogram& histogram, uint64_t calls)
+        : histogram(histogram), calls(calls), started(chrono::steady_clock::now()) {}
+
+    ~ScopedLatencyTimer() {
+        if (calls == 0) return;
+        long long elapsed = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        histogram.record(elapsed / static_cast<long long>(calls), calls);
+    }
 };
 
-class NearestElevatorStrategy : public ElevatorSelectionStrategy {
-public:
-    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
-        if (elevators.empty()) return nullptr;
+// Owned by ElevatorManager and shared by its cars
+struct ElevatorMetrics {
+    LatencyHistogram dispatchLatency;   // Wall ns to route one call to a car
+    LatencyHistogram callServeTime;     // Simulated ms from a stop request to the doors opening
+    LatencyHistogram passengerWait;     // Simulated ms from a destination call to boarding
+    LatencyHistogram queueDepth;        // A car's pending stops each time one is added
+    array<atomic<uint64_t>, STATE_TYPE_COUNT> stateTransitions;  // By new StateType
+    atomic<uint64_t> hallCalls;
+    atomic<uint64_t> destinationCalls;
+    atomic<uint64_t> doorOpenings;
 
-        Elevator* nearestElevator = elevators[0];
-        int shortestDistance = abs(floor - elevators[0]->getCurrentFloor());
+    ElevatorMetrics() : hallCalls(0), destinationCalls(0), doorOpenings(0) {
+        for (atomic<uint64_t>& transitions : stateTransitions) transitions.store(0, memory_order_relaxed);
+    }
 
-        for (Elevator* elevator : elevators) {
-            int distance = abs(floor - elevator->getCurrentFloor());
-            StateType currentState = elevator->getState()->getType();
+    void countTransition(StateType state) {
+        stateTransitions[static_cast<size_t>(state)].fetch_add(1, memory_order_relaxed);
+    }
+};
 
-            // Prioritize idle elevators
-            if (currentState == StateType::IDLE && distance < shortestDistance) {
-                shortestDistance = distance;
-                nearestElevator = elevator;
-                continue;
-            }
+struct MetricsSnapshot {
+    HistogramSnapshot dispatchLatency;
+    HistogramSnapshot callServeTime;
+    HistogramSnapshot passengerWait;
+    HistogramSnapshot queueDepth;
+    array<uint64_t, STATE_TYPE_COUNT> stateTransitions;
+    uint64_t hallCalls;
+    uint64_t destinationCalls;
+    uint64_t doorOpenings;
+    struct CarGauge {
+        int id;
+        int pendingStops;
+    };
+    vector<CarGauge> queueDepthByCar;
+};
 
-            // For moving elevators, consider their direction
-            if (direction == Direction::UP && currentState == StateType::MOVING_UP && 
-                elevator->getCurrentFloor() < floor && distance < shortestDistance) {
-                shortestDistance = distance;
-                nearestElevator = elevator;
-            }
-            else if (direction == Direction::DOWN && currentState == StateType::MOVING_DOWN && 
-                     elevator->getCurrentFloor() > floor && distance < shortestDistance) {
-                shortestDistance = distance;
-                nearestElevator = elevator;
-            }
-        }
+void writePrometheusSummary(ostream& out, const string& name, const string& help, const HistogramSnapshot& h) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " summary\n"
+        << name << "{quantile=\"0.5\"} " << h.p50 << "\n"
+        << name << "{quantile=\"0.9\"} " << h.p90 << "\n"
+        << name << "{quantile=\"0.99\"} " << h.p99 << "\n"
+        << name << "_sum " << h.sum << "\n"
+        << name << "_count " << h.count << "\n";
+}
 
-        return nearestElevator;
+// Prometheus text exposition format
+void writePrometheus(ostream& out, const MetricsSnapshot& snapshot) {
+    writePrometheusSummary(out, "elevator_dispatch_latency_ns", "Wall time to route a call to a car.",
+                           snapshot.dispatchLatency);
+    writePrometheusSummary(out, "elevator_call_serve_time_ms", "Simulated time from stop request to doors opening.",
+                           snapshot.callServeTime);
+    writePrometheusSummary(out, "elevator_passenger_wait_ms", "Simulated time from destination call to boarding.",
+                           snapshot.passengerWait);
+    writePrometheusSummary(out, "elevator_queue_depth_stops", "Pending stops of a car whenever one is added.",
+                           snapshot.queueDepth);
+    out << "# HELP elevator_state_transitions_total State changes by new state.\n"
+        << "# TYPE elevator_state_transitions_total counter\n";
+    for (size_t state = 0; state < STATE_TYPE_COUNT; state++) {
+        out << "elevator_state_transitions_total{state=\"" << getStateName(static_cast<StateType>(state)) << "\"} "
+            << snapshot.stateTransitions[state] << "\n";
     }
-};
+    out << "# TYPE elevator_hall_calls_total counter\nelevator_hall_calls_total " << snapshot.hallCalls << "\n"
+        << "# TYPE elevator_destination_calls_total counter\nelevator_destination_calls_total "
+        << snapshot.destinationCalls << "\n"
+        << "# TYPE elevator_door_openings_total counter\nelevator_door_openings_total " << snapshot.doorOpenings << "\n"
+        << "# HELP elevator_pending_stops Current pending stops per car.\n# TYPE elevator_pending_stops gauge\n";
+    for (const MetricsSnapshot::CarGauge& car : snapshot.queueDepthByCar) {
+        out << "elevator_pending_stops{car=\"" << car.id << "\"} " << car.pendingStops << "\n";
+    }
+}
+#endif
 
-// Concrete States
-class IdleState : public State {
-public:
-    explicit IdleState(Elevator* e) : State(e) {}
-    void moveUp() override;
-    void moveDown() override;
-    void stop() override {} // Already idle
-    StateType getType() override { return StateType::IDLE; }
+// Binary Event Log
+// Fixed 16-byte records after a 16-byte header, so a reader can map the file and
+// index it directly without parsing. Both are raw structs in the writer's byte
+// order; on a host of the other order the version check fails and the log is
+// refused rather than misread.
+enum class LogRecordKind : uint8_t {
+    HALL_CALL,         // floor, value = Direction
+    DESTINATION_CALL,  // floor, extra = destination floor
+    STOP_ADDED,        // car, floor
+    STATE_CHANGE,      // car, floor, value = new StateType
+    FLOOR_ARRIVAL,     // car, floor
+    DOOR_OPEN,         // car, floor
+    DOOR_CLOSE,        // car, floor
+    CAR_CALL           // car, floor
 };
+const int LOG_RECORD_KINDS = 8;
 
-class MovingUpState : public State {
-public:
-    explicit MovingUpState(Elevator* e) : State(e) {}
-    void moveUp() override {} // Continue moving up
-    void moveDown() override;
-    void stop() override;
-    StateType getType() override { return StateType::MOVING_UP; }
+struct LogRecord {
+    int64_t time;      // SimTime, ms
+    LogRecordKind kind;
+    uint8_t value;
+    uint16_t car;      // Elevator id, 0 for hall and destination calls
+    int16_t floor;
+    int16_t extra;     // NO_FLOOR when unused
 };
+static_assert(sizeof(LogRecord) == 16, "log records must stay 16 bytes");
 
-class MovingDownState : public State {
-public:
-    explicit MovingDownState(Elevator* e) : State(e) {}
-    void moveUp() override;
-    void moveDown() override {} // Continue moving down
-    void stop() override;
-    StateType getType() override { return StateType::MOVING_DOWN; }
+struct LogFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
 };
+static_assert(sizeof(LogFileHeader) == 16, "log header must stay 16 bytes");
 
-// Manager Class
-class ElevatorManager {
+const char EVENT_LOG_MAGIC[8] = {'E', 'L', 'V', 'L', 'O', 'G', '0', '1'};
+const uint32_t EVENT_LOG_VERSION = 1;
+
+inline LogRecord makeLogRecord(SimTime time, LogRecordKind kind, int car, int floor, int value = 0,
+                               int extra = NO_FLOOR) {
+    return LogRecord{time, kind, static_cast<uint8_t>(value), static_cast<uint16_t>(car),
+                     static_cast<int16_t>(floor), static_cast<int16_t>(extra)};
+}
+
+// Buffered writer. Appends are serialized by a lock; under runParallel records stay
+// in time order per car but cars may interleave out of order within an epoch. A
+// failed write is sticky: flush and close report it, and later records are dropped.
+class EventLogWriter {
 private:
-    vector<Elevator*> elevators;
-    vector<OuterPanel*> panels;
-    vector<ElevatorObserver*> observers;
-    ElevatorSelectionStrategy* selectionStrategy;
+    FILE* file;
+    vector<LogRecord> buffer;
+    uint64_t written;   // Records handed to the file
+    bool failed;
+    mutex writeLock;
+
+    static const size_t BUFFER_RECORDS = 4096;
+
+    void flushLocked() {
+        if (file && !failed && !buffer.empty()) {
+            if (fwrite(buffer.data(), sizeof(LogRecord), buffer.size(), file) == buffer.size()) {
+                written += buffer.size();
+            } else {
+                failed = true;
+            }
+        }
+        buffer.clear();
+    }
 
 public:
-    ElevatorManager() : selectionStrategy(new NearestElevatorStrategy()) {
-        cout << "Elevator Manager created\n";
+    EventLogWriter() : file(nullptr), written(0), failed(false) { buffer.reserve(BUFFER_RECORDS); }
+    ~EventLogWriter() { close(); }
+
+    EventLogWriter(const EventLogWriter&) = delete;
+    EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+    bool open(const string& path) {
+        close();
+        written = 0;
+        failed = false;
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        LogFileHeader header;
+        memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+        header.version = EVENT_LOG_VERSION;
+        header.recordSize = sizeof(LogRecord);
+        return fwrite(&header, sizeof(header), 1, file) == 1;
     }
 
-    ~ElevatorManager() {
-        delete selectionStrategy;
+    void append(const LogRecord& record) {
+        lock_guard<mutex> guard(writeLock);
+        buffer.push_back(record);
+        if (buffer.size() >= BUFFER_RECORDS) flushLocked();
     }
 
-    void setSelectionStrategy(ElevatorSelectionStrategy* strategy) {
-        delete selectionStrategy;
-        selectionStrategy = strategy;
+    // False once any record has failed to reach the file
+    bool flush() {
+        lock_guard<mutex> guard(writeLock);
+        flushLocked();
+        if (file && fflush(file) != 0) failed = true;
+        return !failed;
     }
 
-    void addToQueue(int floor, Direction direction) {
-        cout << "Request received for floor " << floor << "\n";
-        Elevator* selectedElevator = selectionStrategy->selectElevator(floor, direction, elevators);
-        if (selectedElevator) {
-            selectedElevator->addToQueue(floor);
-        }
+    // False if any record, or the close itself, failed; like saveSnapshot's result
+    bool close() {
+        lock_guard<mutex> guard(writeLock);
+        flushLocked();
+        if (file && fclose(file) != 0) failed = true;
+        file = nullptr;
+        return !failed;
     }
 
-    void notifyObservers(int floor, StateType state) {
-        for (auto observer : observers) {
-            observer->update(floor, state);
+    bool isOpen() const { return file != nullptr; }
+    bool hasFailed() const { return failed; }
+    // Records handed to the file so far; buffered ones count once flushed
+    uint64_t getRecordCount() const { return written; }
+};
+
+// Read-only mapping of a whole file; the kernel pages it in as it is read
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+
+public:
+    MappedFile() : data(nullptr), length(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Fails on unreadable files and on files shorter than `minimumSize`
+    bool open(const string& path, size_t minimumSize = 0) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0 || static_cast<size_t>(info.st_size) < minimumSize) {
+            ::close(fd);
+            return false;
         }
+        void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+        data = static_cast<const char*>(mapped);
+        length = static_cast<size_t>(info.st_size);
+        return true;
     }
 
-    void addPanel(OuterPanel* panel);
+    void close() {
+        if (data) munmap(const_cast<char*>(data), length);
+        data = nullptr;
+        length = 0;
+    }
 
-    void addElevator(Elevator* elevator) {
-        elevators.push_back(elevator);
+    void adviseSequential() const {
+        if (data) madvise(const_cast<char*>(data), length, MADV_SEQUENTIAL);
     }
+
+    const char* bytes() const { return data; }
+    size_t size() const { return length; }
 };
 
-// Outer Panel Class
-class OuterPanel : public ElevatorObserver {
+// Read-only, memory-mapped view of a log file. Records are accessed in place; the
+// kernel pages them in as the caller streams through.
+class MappedEventLog {
 private:
-    int floor;
-    ElevatorManager* manager;
-    int currentDisplayFloor;
-    Direction currentDirection;
+    MappedFile file;
+    size_t count;
 
 public:
-    OuterPanel(int floorNum, ElevatorManager* mgr) 
-        : floor(floorNum), manager(mgr), currentDisplayFloor(1) {
-        cout << "Panel created at floor " << floorNum << "\n";
+    MappedEventLog() : count(0) {}
+
+    // Fails on unreadable files and on a missing or mismatched header
+    bool open(const string& path) {
+        close();
+        if (!file.open(path, sizeof(LogFileHeader))) return false;
+        const LogFileHeader* header = reinterpret_cast<const LogFileHeader*>(file.bytes());
+        if (memcmp(header->magic, EVENT_LOG_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != EVENT_LOG_VERSION || header->recordSize != sizeof(LogRecord)) {
+            close();
+            return false;
+        }
+        count = (file.size() - sizeof(LogFileHeader)) / sizeof(LogRecord);
+        file.adviseSequential();
+        return true;
     }
 
-    void requestElevator(Direction direction) {
-        cout << "Panel at floor " << floor << " requesting elevator\n";
-        manager->addToQueue(floor, direction);
+    void close() {
+        file.close();
+        count = 0;
     }
 
-    void update(int floor, StateType state) override {
-        currentDisplayFloor = floor;
-        cout << "Panel at floor " << this->floor << " updated: Elevator at floor " 
-                 << floor << " (" << getStateName(state) << ")\n";
+    size_t size() const { return count; }
+    const LogRecord* begin() const { return reinterpret_cast<const LogRecord*>(file.bytes() + sizeof(LogFileHeader)); }
+    const LogRecord* end() const { return begin() + count; }
+    const LogRecord& operator[](size_t index) const { return begin()[index]; }
+};
+
+// System Snapshots
+// Flat image of a manager between steps: a header, the strategy's parameters, one
+// fixed-size record per car, the pooled passengers of every car in car order, the
+// pending events and the hall calls re-dispatch is tracking. Every section is an array of 8-byte aligned records, so a mapped
+// file is read in place.
+const int STOP_WORDS = (MAX_FLOORS + 63) / 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t maxFloors;          // MAX_FLOORS of the writer; stop bitsets depend on it
+    int64_t time;                // Simulated clock, ms
+    uint32_t carCount;
+    uint32_t passengerCount;
+    uint32_t eventCount;
+    uint32_t parameterCount;
+    char strategy[24];           // ElevatorSelectionStrategy::getName, NUL-padded
+    int64_t redispatchInterval;  // 0 when re-dispatch is off
+    int64_t nextRedispatch;
+    double redispatchHysteresis;
+    uint32_t assignmentCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(SnapshotHeader) == 96, "snapshot header must stay 96 bytes");
+
+struct CarSnapshot {
+    int32_t id;
+    int32_t currentFloor;
+    int32_t parkingFloor;
+    int32_t capacity;
+    uint8_t state;               // StateType
+    uint8_t sweepDirection;      // Direction
+    uint8_t doorsOpen;
+    uint8_t redispatchDirty;     // Changed since the last re-dispatch pass
+    uint8_t reserved[4];
+    int64_t floorsTravelled;
+    double ratedLoadKg;
+    uint32_t waitingCount;       // Passengers of this car in the passenger section:
+    uint32_t riderCount;         // waiting ones first, then riders
+    uint64_t pendingStops[STOP_WORDS];
+    uint64_t carCalls[STOP_WORDS];
+};
+static_assert(sizeof(CarSnapshot) % 8 == 0, "car records must keep the sections 8-byte aligned");
+
+struct PassengerSnapshot {
+    int32_t id;
+    int32_t sourceFloor;
+    int32_t destinationFloor;
+    int32_t reserved;
+    int64_t requestedAt;
+    double weightKg;
+};
+static_assert(sizeof(PassengerSnapshot) == 32, "passenger records must stay 32 bytes");
+
+struct EventSnapshot {
+    int64_t time;
+    int32_t car;                 // Fleet index, -1 for hall calls
+    int32_t floor;
+    uint8_t type;                // EventType
+    uint8_t direction;           // Direction
+    uint8_t reserved[6];
+};
+static_assert(sizeof(EventSnapshot) == 24, "event records must stay 24 bytes");
+
+// A hall call that re-dispatch may still move to another car
+struct AssignmentSnapshot {
+    int32_t floor;
+    int32_t car;                 // Fleet index
+    double cost;                 // Cost at `car` when last evaluated
+    uint8_t direction;           // Direction
+    uint8_t reserved[7];
+};
+static_assert(sizeof(AssignmentSnapshot) == 24, "assignment records must stay 24 bytes");
+
+const char SNAPSHOT_MAGIC[8] = {'E', 'L', 'V', 'S', 'N', 'P', '0', '1'};
+const uint32_t SNAPSHOT_VERSION = 2;  // 2 added the re-dispatch state
+
+// Discrete-Event Simulation
+struct Event {
+    SimTime time;
+    unsigned long long sequence; // Keeps same-time events in scheduling order
+    EventType type;
+    Elevator* elevator;          // Target car, nullptr for hall calls
+    int floor;
+    Direction direction;
+};
+
+struct EventLater {
+    bool operator()(const Event& a, const Event& b) const {
+        if (a.time != b.time) return a.time > b.time;
+        return a.sequence > b.sequence;
     }
 };
 
-// Elevator Implementation
-Elevator::Elevator(int id, ElevatorManager* mgr) 
-    : id(id), currentFloor(1), manager(mgr) {
-    state = new IdleState(this);
-    cout << "Elevator " << id << " created at floor " << currentFloor << "\n";
-}
+class EventQueue {
+private:
+    priority_queue<Event, vector<Event>, EventLater> events;
+    SimTime now;
+    unsigned long long nextSequence;
 
-void Elevator::setState(State* newState) {
-    delete state;
-    state = newState;
-    cout << "Elevator " << id << " changed state to " << getStateName(newState->getType()) << "\n";
-}
+public:
+    EventQueue() : now(0), nextSequence(0) {}
 
-void Elevator::addToQueue(int floor) {
-    floorQueue.push(floor);
-    cout << "Elevator " << id << " received request for floor " << floor << "\n";
-    processQueue();
-}
+    void schedule(SimTime at, EventType type, Elevator* elevator, int floor = 0,
+                  Direction direction = Direction::UP) {
+        events.push(Event{at < now ? now : at, nextSequence++, type, elevator, floor, direction});
+    }
 
-void Elevator::processQueue() {
-    if (floorQueue.empty()) return;
-    
-    int targetFloor = floorQueue.front();
-    cout << "Elevator " << id << " processing request for floor " << targetFloor << "\n";
-    
-    if (targetFloor > currentFloor) {
-        state->moveUp();
-        simulateMovement(targetFloor);
-    } else if (targetFloor < currentFloor) {
-        state->moveDown();
-        simulateMovement(targetFloor);
+    // Removes the earliest event and advances the clock to its timestamp
+    Event pop() {
+        Event event = events.top();
+        events.pop();
+        now = event.time;
+        return event;
     }
-}
 
-void Elevator::simulateMovement(int targetFloor) {
-    while (currentFloor != targetFloor) {
-        if (targetFloor > currentFloor) {
-            currentFloor++;
-        } else {
-            currentFloor--;
+    // Moves the clock forward without processing anything
+    void advanceTo(SimTime time) {
+        if (time > now) now = time;
+    }
+
+    // Removes every pending event in time order, leaving the clock untouched
+    vector<Event> takeAll() {
+        vector<Event> pending;
+        pending.reserve(events.size());
+        while (!events.empty()) {
+            pending.push_back(events.top());
+            events.pop();
         }
-        cout << "Elevator " << id << " is now at floor " << currentFloor << "\n";
+        return pending;
     }
-    floorQueue.pop();
-    state->stop();
-}
 
-// State Implementations
-void IdleState::moveUp() {
-    elevator->setState(new MovingUpState(elevator));
-}
+    // Drops every pending event `predicate` matches; the rest keep their order
+    template <typename Predicate>
+    size_t removeIf(Predicate predicate) {
+        vector<Event> kept;
+        kept.reserve(events.size());
+        size_t removed = 0;
+        while (!events.empty()) {
+            if (predicate(events.top())) removed++;
+            else kept.push_back(events.top());
+            events.pop();
+        }
+        events = priority_queue<Event, vector<Event>, EventLater>(EventLater(), std::move(kept));
+        return removed;
+    }
 
-void IdleState::moveDown() {
-    elevator->setState(new MovingDownState(elevator));
-}
+    bool empty() const { return events.empty(); }
+    size_t size() const { return events.size(); }
+    SimTime nextTime() const { return events.top().time; }
+    SimTime getTime() const { return now; }
+};
 
-void MovingUpState::moveDown() {
-    elevator->setState(new MovingDownState(elevator));
-}
+// Pending stops of one car: one bit per floor, so dedupe is a bit test and the
+// next stop in either direction is a count-trailing/leading-zeros per 64 floors
+template <int Floors>
+class FloorBitset {
+private:
+    static const int WORDS = (Floors + 63) / 64;
+    uint64_t words[WORDS];
+    int count;
 
-void MovingUpState::stop() {
-    elevator->setState(new IdleState(elevator));
-}
+public:
+    FloorBitset() : words(), count(0) {}
 
-void MovingDownState::moveUp() {
-    elevator->setState(new MovingUpState(elevator));
-}
+    static bool inRange(int floor) { return floor >= 0 && floor < Floors; }
 
-void MovingDownState::stop() {
-    elevator->setState(new IdleState(elevator));
-}
+    // Returns false if the floor was already pending or is outside the building
+    bool add(int floor) {
+        if (!inRange(floor)) return false;
+        uint64_t bit = 1ULL << (floor & 63);
+        uint64_t& word = words[floor >> 6];
+        if (word & bit) return false;
+        word |= bit;
+        count++;
+        return true;
+    }
 
-// Implement addPanel after OuterPanel is fully defined
-void ElevatorManager::addPanel(OuterPanel* panel) {
-    panels.push_back(panel);
-    observers.push_back(panel);
-}
+    bool remove(int floor) {
+        if (!contains(floor)) return false;
+        words[floor >> 6] &= ~(1ULL << (floor & 63));
+        count--;
+        return true;
+    }
 
-int main() {
-    cout << "Starting Elevator System Simulation\n";
-    cout << "===================================\n\n";
+    bool contains(int floor) const {
+        return inRange(floor) && (words[floor >> 6] >> (floor & 63)) & 1;
+    }
 
-    // Create manager
-    ElevatorManager* manager = new ElevatorManager();
+    bool empty() const { return count == 0; }
+    size_t size() const { return static_cast<size_t>(count); }
 
-    // Create multiple elevators
-    Elevator* elevator1 = new Elevator(1, manager);
-    Elevator* elevator2 = new Elevator(2, manager);
-    manager->addElevator(elevator1);
-    manager->addElevator(elevator2);
-
-    // Create panels for floors
-    OuterPanel* panel1 = new OuterPanel(1, manager);
-    OuterPanel* panel2 = new OuterPanel(2, manager);
-    OuterPanel* panel3 = new OuterPanel(3, manager);
-    manager->addPanel(panel1);
-    manager->addPanel(panel2);
-    manager->addPanel(panel3);
+    // Closest pending stop strictly above / below the given floor, or NO_FLOOR
+    int nextAbove(int floor) const {
+        int start = floor + 1;
+        if (start < 0) start = 0;
+        if (start >= Floors) return NO_FLOOR;
+        int index = start >> 6;
+        uint64_t word = words[index] & (~0ULL << (start & 63));
+        while (true) {
+            if (word) return (index << 6) + lowestSetBit(word);
+            if (++index == WORDS) return NO_FLOOR;
+            word = words[index];
+        }
+    }
 
-    cout << "\nSimulating elevator requests\n";
+    int nextBelow(int floor) const {
+        int end = floor - 1;
+        if (end >= Floors) end = Floors - 1;
+        if (end < 0) return NO_FLOOR;
+        int index = end >> 6;
+        uint64_t word = words[index] & (~0ULL >> (63 - (end & 63)));
+        while (true) {
+            if (word) return (index << 6) + highestSetBit(word);
+            if (--index < 0) return NO_FLOOR;
+            word = words[index];
+        }
+    }
+
+    int lowest() const { return nextAbove(-1); }
+    int highest() const { return nextBelow(Floors); }
+
+    // Raw 64-floor words, for snapshots
+    static int wordCount() { return WORDS; }
+    uint64_t word(int index) const { return words[index]; }
+    // Bits of word `index` that are floors; the last word may run past the top floor
+    static uint64_t wordMask(int index) {
+        int floors = Floors - index * 64;
+        return floors >= 64 ? ~0ULL : (1ULL << floors) - 1;
+    }
+    // Bits past the top floor are dropped
+    void setWord(int index, uint64_t value) {
+        value &= wordMask(index);
+        count += countSetBits(value) - countSetBits(words[index]);
+        words[index] = value;
+    }
+
+    // Pending stops in [low, high], one popcount per 64 floors
+    int countBetween(int low, int high) const {
+        if (low < 0) low = 0;
+        if (high >= Floors) high = Floors - 1;
+        if (low > high) return 0;
+        int first = low >> 6;
+        int last = high >> 6;
+        uint64_t lowMask = ~0ULL << (low & 63);
+        uint64_t highMask = ~0ULL >> (63 - (high & 63));
+        if (first == last) return countSetBits(words[first] & lowMask & highMask);
+        int total = countSetBits(words[first] & lowMask) + countSetBits(words[last] & highMask);
+        for (int index = first + 1; index < last; index++) {
+            total += countSetBits(words[index]);
+        }
+        return total;
+    }
+};
+
+using StopSet = FloorBitset<MAX_FLOORS>;
+
+// Observer Interface
+class ElevatorObserver {
+public:
+    virtual void update(int floor, StateType state) = 0;
+    virtual ~ElevatorObserver() = default;
+};
+
+// Passenger-level events for tracked destination calls, e.g. to measure wait and
+// journey times. Called from the car's own event handler, so under runParallel an
+// implementation may only touch per-passenger state.
+class TripObserver {
+public:
+    virtual void onBoard(int passenger, int elevatorId, int floor, SimTime time) = 0;
+    virtual void onAlight(int passenger, int elevatorId, int floor, SimTime time) = 0;
+    virtual ~TripObserver() = default;
+};
+
+// State Pattern
+// States carry no per-car data; the elevator is passed in so one instance can be shared
+class State {
+public:
+    virtual void moveUp(Elevator& elevator) = 0;
+    virtual void moveDown(Elevator& elevator) = 0;
+    virtual void stop(Elevator& elevator) = 0;
+    virtual StateType getType() const = 0;
+    virtual ~State() = default;
+};
+
+// Forward declare concrete states
+class IdleState;
+class MovingUpState;
+class MovingDownState;
+
+// Cached outlook of a car's remaining work, refreshed whenever its stops, doors or
+// position change so strategies can read it in constant time
+struct RouteSummary {
+    int lastStop;          // Floor the car ends up at once every pending stop is served
+    int remainingFloors;   // Floors still to travel in LOOK order
+    SimTime freeAt;        // Simulated time at which the car will next be idle
+};
+
+// Assumed weight of a passenger when the caller gives none
+const double NOMINAL_PASSENGER_KG = 75.0;
+
+// One destination-dispatch trip, recycled through the manager's passenger pool
+struct Passenger {
+    int id;                // Trip id reported to the TripObserver, -1 if untracked
+    int sourceFloor;
+    int destinationFloor;
+    SimTime requestedAt;
+    double weightKg;
+};
+
+// Core Elevator Class
+class Elevator {
+private:
+    int id;
+    int currentFloor;
+    State* state;                  // Shared built-in state or customState.get()
+    StateType stateType;           // Cached state->getType()
+    unique_ptr<State> customState; // Owned only when a custom state is installed
+    StopSet pendingStops;          // Every stop: assigned hall calls and car calls
+    StopSet carCalls;              // Stops requested from inside; committed to this car
+    Direction sweepDirection;      // LOOK: keep serving this way until no stops remain ahead
+    ElevatorManager* manager;
+    bool doorsOpen;
+    long long floorsTravelled;
+    int fleetIndex;                // Slot in the manager's FleetView, -1 until added
+    int parkingFloor;              // Where an idle car is heading without a stop, or NO_FLOOR
+
+    // Passengers assigned to this car, in arrival order, waiting at their source
+    // floor; each destination becomes a car call once they board
+    vector<Passenger*> waiting;
+    vector<Passenger*> riders;     // On board
+    int capacity;                  // Persons, 0 for unlimited
+    double ratedLoadKg;            // 0 for unlimited
+    double loadKg;
+#if ELEVATOR_METRICS
+    array<SimTime, MAX_FLOORS> stopRequestedAt{};  // When each pending stop was added
+#endif
+    array<uint16_t, MAX_FLOORS> plannedDropoffs;  // Waiting passengers per destination floor
+    RouteSummary route;
+
+    int nextStop() const;
+    void refreshRoute();
+    void syncFleetView();
+    void boardPassenger(Passenger* passenger);
+    void handBack(Passenger* passenger);
+    void continueAfterBypass();
+    void becomeIdle();
+    void logEvent(LogRecordKind kind, int floor, int value = 0) const;
+
+public:
+    Elevator(int id, ElevatorManager* mgr);
+
+    // Switches to a shared built-in state; allocates nothing
+    void setState(StateType newType);
+    // Installs a caller-supplied state, owned by this elevator until replaced
+    void setState(unique_ptr<State> newState);
+    void addToQueue(int floor);
+    // Stop requested from inside the car, served in the same sweep as hall calls
+    void addCarCall(int floor);
+    // Picks a passenger up at sourceFloor and then stops at their destination
+    void addDestinationCall(int sourceFloor, int destinationFloor, int passenger = -1);
+    // Takes over a pooled passenger, e.g. one handed back by a full car
+    void assignPassenger(Passenger* passenger);
+    // Persons and rated load; 0 leaves that limit off
+    void setCapacity(int persons, double ratedLoad = 0.0);
+    // Moves an idle car to `floor` without opening its doors. Any stop assigned on the
+    // way takes over the trip.
+    void parkAt(int floor);
+    // Gives up an assigned hall stop so another car can take it. Refuses stops that
+    // serve a car call or one of this car's passengers.
+    bool withdrawStop(int floor);
+    // Takes back a passenger still waiting for this car, together with the pickup stop
+    // unless `keepStop` or something else needs it; false if they are not waiting here
+    bool unassignPassenger(Passenger* passenger, bool keepStop);
+    // Fault or maintenance: the car stays at its current floor and appends everything
+    // it still owed to `displaced` for other cars, see ElevatorManager::takeOutOfService
+    void takeOutOfService(vector<HallCall>& displaced);
+    void returnToService();
+    // Snapshot support, see ElevatorManager::writeSnapshot. A custom state is saved as
+    // its StateType and comes back as the built-in state of that type.
+    void saveTo(CarSnapshot& record) const;
+    void restoreFrom(const CarSnapshot& record, vector<Passenger*> waitingPassengers,
+                     vector<Passenger*> ridingPassengers);
+    const vector<Passenger*>& getWaitingPassengers() const { return waiting; }
+    const vector<Passenger*>& getRiders() const { return riders; }
+    void processQueue();
+
+    // Event handlers, invoked by ElevatorManager as the simulated clock advances
+    void onFloorArrival();
+    void onDoorOpen();
+    void onDoorClose();
+    
+    int getCurrentFloor() const { return currentFloor; }
+    int getId() const { return id; }
+    int getFleetIndex() const { return fleetIndex; }
+    void setFleetIndex(int index) { fleetIndex = index; syncFleetView(); }
+    Direction getSweepDirection() const { return sweepDirection; }
+    size_t getPendingStopCount() const { return pendingStops.size(); }
+    bool hasPendingStop(int floor) const { return pendingStops.contains(floor); }
+    const StopSet& getPendingStops() const { return pendingStops; }
+    size_t getCarCallCount() const { return carCalls.size(); }
+    bool hasCarCall(int floor) const { return carCalls.contains(floor); }
+    const RouteSummary& getRouteSummary() const { return route; }
+    bool areDoorsOpen() const { return doorsOpen; }
+    int getParkingFloor() const { return parkingFloor; }
+    // Idle with nothing to do: no stops, doors closed and not heading to a parking floor
+    bool isVacant() const {
+        return stateType == StateType::IDLE && !doorsOpen && pendingStops.empty() && parkingFloor == NO_FLOOR;
+    }
+    // True if the floor is already part of this car's plan, including drop-offs of
+    // passengers it has yet to pick up
+    bool willStopAt(int floor) const;
+    long long getFloorsTravelled() const { return floorsTravelled; }
+    int getCapacity() const { return capacity; }
+    size_t getPassengerCount() const { return riders.size(); }
+    double getLoadKg() const { return loadKg; }
+    bool hasRoomFor(const Passenger& passenger) const {
+        return (capacity <= 0 || riders.size() < static_cast<size_t>(capacity)) &&
+               (ratedLoadKg <= 0.0 || loadKg + passenger.weightKg <= ratedLoadKg);
+    }
+    // Load weighing: no room for another passenger of nominal weight
+    bool isFull() const {
+        return (capacity > 0 && riders.size() >= static_cast<size_t>(capacity)) ||
+               (ratedLoadKg > 0.0 && loadKg + NOMINAL_PASSENGER_KG > ratedLoadKg);
+    }
+    State* getState() const { return state; }
+    StateType getStateType() const { return stateType; }
+    bool isBusy() const { return doorsOpen || stateType != StateType::IDLE; }
+    bool isInService() const { return stateType != StateType::OUT_OF_SERVICE; }
+};
+
+// Structure-of-arrays snapshot of the fleet, kept current by each Elevator.
+// Slot i of every array describes elevators[i] of the owning ElevatorManager.
+struct FleetView {
+    vector<int> currentFloor;
+    vector<int> state;         // StateType
+    vector<int> direction;     // Sweep direction: +1 up, -1 down
+    vector<int> pendingStops;
+    vector<int> full;           // 1 once load weighing says no one else fits
+    vector<int> lastStop;       // From each car's RouteSummary
+    vector<int> remainingFloors;
+    vector<SimTime> freeAt;
+
+    size_t size() const { return currentFloor.size(); }
+
+    void reserve(size_t count) {
+        currentFloor.reserve(count);
+        state.reserve(count);
+        direction.reserve(count);
+        pendingStops.reserve(count);
+        full.reserve(count);
+        lastStop.reserve(count);
+        remainingFloors.reserve(count);
+        freeAt.reserve(count);
+    }
+
+    void resize(size_t count) {
+        currentFloor.resize(count);
+        state.resize(count);
+        direction.resize(count);
+        pendingStops.resize(count);
+        full.resize(count);
+        lastStop.resize(count);
+        remainingFloors.resize(count);
+        freeAt.resize(count);
+    }
+
+    // Slot `to` takes the values of slot `from` of `other`
+    void copySlot(size_t to, const FleetView& other, size_t from) {
+        currentFloor[to] = other.currentFloor[from];
+        state[to] = other.state[from];
+        direction[to] = other.direction[from];
+        pendingStops[to] = other.pendingStops[from];
+        full[to] = other.full[from];
+        lastStop[to] = other.lastStop[from];
+        remainingFloors[to] = other.remainingFloors[from];
+        freeAt[to] = other.freeAt[from];
+    }
+};
+
+// A single hall-call button press; with destination dispatch the passenger also keys
+// in where they are going
+struct HallCall {
+    int floor;
+    Direction direction;
+    int destinationFloor = NO_FLOOR;
+    int carIndex = -1;           // Fleet index of the car, for a car call from inside it
+    Passenger* passenger = nullptr;  // Pooled passenger handed back for re-dispatch
+
+    bool hasDestination() const { return destinationFloor != NO_FLOOR; }
+    bool isCarCall() const { return carIndex >= 0 && floor != NO_FLOOR; }
+    // Not a call: the car at carIndex has run out of work and may be parked
+    bool isIdleNotice() const { return carIndex >= 0 && floor == NO_FLOOR; }
+};
+
+// Bounded lock-free multi-producer / single-consumer queue (Vyukov ring).
+// Any thread may push; only one thread at a time may pop.
+template <typename T>
+class MpscQueue {
+private:
+    struct Slot {
+        atomic<size_t> sequence; // == position when free, position + 1 when filled
+        T value;
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    char padBeforeTail[64];
+    atomic<size_t> tail;         // Shared by producers
+    char padBeforeHead[64];
+    size_t head;                 // Owned by the consumer
+
+public:
+    // Capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity) : tail(0), head(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+
+    // Returns false without blocking when the queue is full
+    bool tryPush(const T& value) {
+        size_t position = tail.load(memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & mask];
+            size_t sequence = slot->sequence.load(memory_order_acquire);
+            intptr_t lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (lag == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = tail.load(memory_order_relaxed);
+            }
+        }
+        slot->value = value;
+        slot->sequence.store(position + 1, memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        Slot* slot = &slots[head & mask];
+        if (slot->sequence.load(memory_order_acquire) != head + 1) return false;
+        value = slot->value;
+        slot->sequence.store(head + mask + 1, memory_order_release);
+        head++;
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+};
+
+const size_t HALL_CALL_INTAKE_CAPACITY = 4096;
+
+// Address-stable storage for objects owned by ElevatorManager. Objects are
+// constructed in place inside large chunks and destroyed together with the arena,
+// so building a whole fleet costs one allocation instead of one per object.
+template <typename T>
+class ObjectArena {
+private:
+    struct Chunk {
+        T* objects;
+        size_t capacity;
+        size_t used;
+    };
+
+    vector<Chunk> chunks;
+    size_t count;
+
+public:
+    ObjectArena() : count(0) {}
+    ObjectArena(const ObjectArena&) = delete;
+    ObjectArena& operator=(const ObjectArena&) = delete;
+
+    ~ObjectArena() {
+        for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+            for (size_t i = chunk->used; i-- > 0;) {
+                chunk->objects[i].~T();
+            }
+            ::operator delete(chunk->objects);
+        }
+    }
+
+    // Guarantees room for `extra` more objects without further allocation
+    void reserve(size_t extra) {
+        if (!chunks.empty() && chunks.back().capacity - chunks.back().used >= extra) return;
+        chunks.push_back(Chunk{static_cast<T*>(::operator new(sizeof(T) * extra)), extra, 0});
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (chunks.empty() || chunks.back().used == chunks.back().capacity) {
+            reserve(max<size_t>(16, count));
+        }
+        Chunk& chunk = chunks.back();
+        T* object = new (chunk.objects + chunk.used) T(std::forward<Args>(args)...);
+        chunk.used++;
+        count++;
+        return object;
+    }
+
+    size_t size() const { return count; }
+};
+
+// Free-list pool on top of ObjectArena for short-lived objects: released objects are
+// reused before new storage is carved out. Locked, since cars release from their own
+// event handlers under runParallel.
+template <typename T>
+class ObjectPool {
+private:
+    ObjectArena<T> storage;
+    vector<T*> released;
+    mutex poolLock;
+
+public:
+    template <typename... Args>
+    T* acquire(Args&&... args) {
+        lock_guard<mutex> guard(poolLock);
+        if (released.empty()) return storage.create(std::forward<Args>(args)...);
+        T* object = released.back();
+        released.pop_back();
+        *object = T{std::forward<Args>(args)...};
+        return object;
+    }
+
+    void release(T* object) {
+        lock_guard<mutex> guard(poolLock);
+        released.push_back(object);
+    }
+
+    // Objects currently handed out
+    size_t inUse() {
+        lock_guard<mutex> guard(poolLock);
+        return storage.size() - released.size();
+    }
+};
+
+// Persistent worker threads that run batches of indexed tasks. Each batch is split
+// into one contiguous range per worker; a worker that finishes its range steals the
+// remaining tasks of the others. The calling thread takes part as worker 0. Under
+// runParallel a task is one car shard, so stealing balances shards between workers;
+// hall calls are never stolen, they stay assigned to the car the dispatcher chose.
+class WorkStealingPool {
+private:
+    struct TaskRange {
+        atomic<size_t> next;
+        size_t end;
+        char pad[64];            // Keep each range's cursor on its own cache line
+    };
+
+    vector<thread> threads;
+    unique_ptr<TaskRange[]> ranges;
+    size_t workerCount;
+    function<void(size_t)> task;
+    mutex batchLock;
+    condition_variable batchStarted;
+    condition_variable batchFinished;
+    size_t generation;
+    size_t running;
+    bool stopping;
+
+    void runTasks(size_t self) {
+        for (size_t offset = 0; offset < workerCount; offset++) {
+            TaskRange& range = ranges[(self + offset) % workerCount];
+            size_t index;
+            while ((index = range.next.fetch_add(1, memory_order_relaxed)) < range.end) {
+                task(index);
+            }
+        }
+    }
+
+    void workerLoop(size_t self) {
+        size_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(batchLock);
+                batchStarted.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            runTasks(self);
+            lock_guard<mutex> guard(batchLock);
+            if (--running == 0) batchFinished.notify_one();
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t workers)
+        : ranges(new TaskRange[max<size_t>(1, workers)]), workerCount(max<size_t>(1, workers)),
+          generation(0), running(0), stopping(false) {
+        for (size_t i = 1; i < workerCount; i++) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(batchLock);
+            stopping = true;
+        }
+        batchStarted.notify_all();
+        for (thread& worker : threads) worker.join();
+    }
+
+    // Runs fn(0) .. fn(taskCount - 1) across the pool and returns once all have finished
+    void runAll(size_t taskCount, const function<void(size_t)>& fn) {
+        {
+            lock_guard<mutex> guard(batchLock);
+            task = fn;
+            for (size_t w = 0; w < workerCount; w++) {
+                ranges[w].next.store(taskCount * w / workerCount, memory_order_relaxed);
+                ranges[w].end = taskCount * (w + 1) / workerCount;
+            }
+            running = threads.size();
+            generation++;
+        }
+        batchStarted.notify_all();
+        runTasks(0);
+        unique_lock<mutex> guard(batchLock);
+        batchFinished.wait(guard, [this] { return running == 0; });
+    }
+
+    size_t size() const { return workerCount; }
+};
+
+// Strategy Pattern
+class ElevatorSelectionStrategy {
+public:
+    virtual Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) = 0;
+
+    // Fleet-array overload used by ElevatorManager; returns a fleet index or -1.
+    // Strategies that only implement selectElevator still work through this default.
+    virtual int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                                    const vector<Elevator*>& elevators) {
+        (void)fleet;
+        Elevator* selected = selectElevator(floor, direction, elevators);
+        for (size_t i = 0; i < elevators.size(); i++) {
+            if (elevators[i] == selected) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // Assigns a burst of calls at once, writing a fleet index (or -1) per call.
+    // The default ranks each call against a scratch copy of the fleet that already
+    // reflects the batch's earlier assignments, and answers repeated calls once.
+    virtual void selectElevatorBatch(const HallCall* calls, size_t count, const FleetView& fleet,
+                                     const vector<Elevator*>& elevators, int* assignments) {
+        FleetView projected = fleet;
+        vector<int> assignedByCall(2 * MAX_FLOORS, -2); // -2: call not seen in this batch yet
+        for (size_t c = 0; c < count; c++) {
+            const HallCall& call = calls[c];
+            if (call.floor < 0 || call.floor >= MAX_FLOORS) {
+                assignments[c] = -1;
+                continue;
+            }
+            // Destination calls are separate passengers, so only plain hall calls merge
+            int unmerged = -2;
+            int& previous = call.hasDestination() ? unmerged
+                                                  : assignedByCall[2 * call.floor + (call.direction == Direction::UP ? 0 : 1)];
+            if (previous != -2) {
+                assignments[c] = previous;
+                continue;
+            }
+            int selected = call.hasDestination() ? selectElevatorForDestination(call, projected, elevators)
+                                                 : selectElevatorIndex(call.floor, call.direction, projected, elevators);
+            assignments[c] = previous = selected;
+            if (selected < 0) continue;
+
+            // The chosen car is now committed to travelling toward this floor
+            size_t i = static_cast<size_t>(selected);
+            projected.pendingStops[i]++;
+            if (projected.state[i] == static_cast<int>(StateType::IDLE) &&
+                projected.currentFloor[i] != call.floor) {
+                bool up = call.floor > projected.currentFloor[i];
+                projected.state[i] = static_cast<int>(up ? StateType::MOVING_UP : StateType::MOVING_DOWN);
+                projected.direction[i] = up ? 1 : -1;
+            }
+        }
+    }
+
+    // Chooses a car for a call that carries a destination floor. The default treats it
+    // as a plain hall call at the source floor.
+    virtual int selectElevatorForDestination(const HallCall& call, const FleetView& fleet,
+                                             const vector<Elevator*>& elevators) {
+        return selectElevatorIndex(call.floor, call.direction, fleet, elevators);
+    }
+
+    // Name understood by makeSelectionStrategy and the tunable parameters, both
+    // saved with manager snapshots
+    virtual const char* getName() const { return "custom"; }
+    virtual vector<double> getParameters() const { return {}; }
+    virtual void setParameters(const vector<double>&) {}
+
+    virtual ~ElevatorSelectionStrategy() = default;
+};
+
+class NearestElevatorStrategy : public ElevatorSelectionStrategy {
+public:
+    const char* getName() const override { return "nearest"; }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        if (elevators.empty()) return nullptr;
+
+        Elevator* nearestElevator = elevators[0];
+        int shortestDistance = abs(floor - elevators[0]->getCurrentFloor());
+
+        for (Elevator* elevator : elevators) {
+            int distance = abs(floor - elevator->getCurrentFloor());
+            StateType currentState = elevator->getStateType();
+
+            // Prioritize idle elevators
+            if (currentState == StateType::IDLE && distance < shortestDistance) {
+                shortestDistance = distance;
+                nearestElevator = elevator;
+                continue;
+            }
+
+            // For moving elevators, consider their direction
+            if (direction == Direction::UP && currentState == StateType::MOVING_UP && 
+                elevator->getCurrentFloor() < floor && distance < shortestDistance) {
+                shortestDistance = distance;
+                nearestElevator = elevator;
+            }
+            else if (direction == Direction::DOWN && currentState == StateType::MOVING_DOWN && 
+                     elevator->getCurrentFloor() > floor && distance < shortestDistance) {
+                shortestDistance = distance;
+                nearestElevator = elevator;
+            }
+        }
+
+        return nearestElevator;
+    }
+
+    // Same ranking as selectElevator in a single pass over contiguous arrays
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>&) override {
+        const size_t count = fleet.size();
+        if (count == 0) return -1;
+
+        const int* floors = fleet.currentFloor.data();
+        const int* states = fleet.state.data();
+        const int idle = static_cast<int>(StateType::IDLE);
+        const int wanted = static_cast<int>(direction == Direction::UP ? StateType::MOVING_UP
+                                                                        : StateType::MOVING_DOWN);
+        int nearest = 0;
+        int shortestDistance = abs(floor - floors[0]);
+
+        for (size_t i = 0; i < count; i++) {
+            int distance = abs(floor - floors[i]);
+            bool approaching = direction == Direction::UP ? floors[i] < floor : floors[i] > floor;
+            bool eligible = states[i] == idle || (states[i] == wanted && approaching);
+            if (eligible && distance < shortestDistance) {
+                shortestDistance = distance;
+                nearest = static_cast<int>(i);
+            }
+        }
+
+        return nearest;
+    }
+};
+
+// Nearest-car selection kernels over FleetView arrays.
+// Car i costs its distance if it is idle or already travelling toward the call in the
+// requested direction, INT_MAX otherwise; car 0 always costs its distance, matching
+// NearestElevatorStrategy's fallback. The result is the first car with the lowest cost.
+struct NearestCarKernel {
+    const char* name;
+    int (*run)(const int* floors, const int* states, size_t count, int floor, Direction direction);
+};
+
+inline int nearestCarCost(int carFloor, int carState, int floor, int wanted, int sign) {
+    int offset = floor - carFloor;
+    bool eligible = carState == static_cast<int>(StateType::IDLE) ||
+                    (carState == wanted && offset * sign > 0);
+    return eligible ? abs(offset) : INT_MAX;
+}
+
+inline int wantedStateFor(Direction direction) {
+    return static_cast<int>(direction == Direction::UP ? StateType::MOVING_UP : StateType::MOVING_DOWN);
+}
+
+int nearestCarScalar(const int* floors, const int* states, size_t count, int floor, Direction direction) {
+    if (count == 0) return -1;
+    const int wanted = wantedStateFor(direction);
+    const int sign = direction == Direction::UP ? 1 : -1;
+    int nearest = 0;
+    int lowestCost = abs(floor - floors[0]);
+    for (size_t i = 1; i < count; i++) {
+        int cost = nearestCarCost(floors[i], states[i], floor, wanted, sign);
+        if (cost < lowestCost) {
+            lowestCost = cost;
+            nearest = static_cast<int>(i);
+        }
+    }
+    return nearest;
+}
+
+#ifdef ELEVATOR_HAS_AVX2_KERNEL
+// Costs of cars [i, i + 8)
+__attribute__((target("avx2")))
+static inline __m256i nearestCarCostsAvx2(const int* floors, const int* states, size_t i,
+                                          const __m256i& vFloor, const __m256i& vSign,
+                                          const __m256i& vWanted) {
+    const __m256i vIdle = _mm256_set1_epi32(static_cast<int>(StateType::IDLE));
+    const __m256i vMax = _mm256_set1_epi32(INT_MAX);
+    __m256i carFloors = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(floors + i));
+    __m256i carStates = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + i));
+    __m256i offset = _mm256_sub_epi32(vFloor, carFloors);
+    __m256i approaching = _mm256_cmpgt_epi32(_mm256_sign_epi32(offset, vSign), _mm256_setzero_si256());
+    __m256i eligible = _mm256_or_si256(
+        _mm256_cmpeq_epi32(carStates, vIdle),
+        _mm256_and_si256(_mm256_cmpeq_epi32(carStates, vWanted), approaching));
+    return _mm256_blendv_epi8(vMax, _mm256_abs_epi32(offset), eligible);
+}
+
+// 8 cars per instruction; built for AVX2 regardless of -march and chosen at runtime
+__attribute__((target("avx2")))
+int nearestCarAvx2(const int* floors, const int* states, size_t count, int floor, Direction direction) {
+    if (count == 0) return -1;
+    const int wanted = wantedStateFor(direction);
+    const int sign = direction == Direction::UP ? 1 : -1;
+    const __m256i vFloor = _mm256_set1_epi32(floor);
+    const __m256i vSign = _mm256_set1_epi32(sign);
+    const __m256i vWanted = _mm256_set1_epi32(wanted);
+
+    // Pass 1: lowest cost across the fleet
+    int lowestCost = abs(floor - floors[0]);
+    size_t i = 1;
+    __m256i vLowest = _mm256_set1_epi32(lowestCost);
+    for (; i + 8 <= count; i += 8) {
+        vLowest = _mm256_min_epi32(vLowest, nearestCarCostsAvx2(floors, states, i, vFloor, vSign, vWanted));
+    }
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(vLowest), _mm256_extracti128_si256(vLowest, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    lowestCost = _mm_cvtsi128_si32(half);
+    for (size_t j = i; j < count; j++) {
+        lowestCost = min(lowestCost, nearestCarCost(floors[j], states[j], floor, wanted, sign));
+    }
+
+    // Pass 2: first car at that cost
+    if (abs(floor - floors[0]) == lowestCost) return 0;
+    const __m256i vTarget = _mm256_set1_epi32(lowestCost);
+    for (i = 1; i + 8 <= count; i += 8) {
+        __m256i costs = nearestCarCostsAvx2(floors, states, i, vFloor, vSign, vWanted);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(costs, vTarget)));
+        if (mask) return static_cast<int>(i) + lowestSetBit(static_cast<uint64_t>(mask));
+    }
+    for (; i < count; i++) {
+        if (nearestCarCost(floors[i], states[i], floor, wanted, sign) == lowestCost) return static_cast<int>(i);
+    }
+    return 0;
+}
+#endif
+
+#ifdef ELEVATOR_HAS_NEON_KERNEL
+// 4 cars per instruction; NEON is always present on AArch64
+int nearestCarNeon(const int* floors, const int* states, size_t count, int floor, Direction direction) {
+    if (count == 0) return -1;
+    const int wanted = wantedStateFor(direction);
+    const int sign = direction == Direction::UP ? 1 : -1;
+    const int32x4_t vFloor = vdupq_n_s32(floor);
+    const int32x4_t vSign = vdupq_n_s32(sign);
+    const int32x4_t vIdle = vdupq_n_s32(static_cast<int>(StateType::IDLE));
+    const int32x4_t vWanted = vdupq_n_s32(wanted);
+    const int32x4_t vMax = vdupq_n_s32(INT_MAX);
+    const int32x4_t vZero = vdupq_n_s32(0);
+
+    auto costs = [&](size_t i) {
+        int32x4_t carFloors = vld1q_s32(floors + i);
+        int32x4_t carStates = vld1q_s32(states + i);
+        int32x4_t offset = vsubq_s32(vFloor, carFloors);
+        uint32x4_t approaching = vcgtq_s32(vmulq_s32(offset, vSign), vZero);
+        uint32x4_t eligible = vorrq_u32(vceqq_s32(carStates, vIdle),
+                                        vandq_u32(vceqq_s32(carStates, vWanted), approaching));
+        return vbslq_s32(eligible, vabsq_s32(offset), vMax);
+    };
+
+    int lowestCost = abs(floor - floors[0]);
+    size_t i = 1;
+    int32x4_t vLowest = vdupq_n_s32(lowestCost);
+    for (; i + 4 <= count; i += 4) {
+        vLowest = vminq_s32(vLowest, costs(i));
+    }
+    lowestCost = vminvq_s32(vLowest);
+    for (size_t j = i; j < count; j++) {
+        lowestCost = min(lowestCost, nearestCarCost(floors[j], states[j], floor, wanted, sign));
+    }
+
+    if (abs(floor - floors[0]) == lowestCost) return 0;
+    const int32x4_t vTarget = vdupq_n_s32(lowestCost);
+    for (i = 1; i + 4 <= count; i += 4) {
+        if (vmaxvq_u32(vceqq_s32(costs(i), vTarget))) break;
+    }
+    for (; i < count; i++) {
+        if (nearestCarCost(floors[i], states[i], floor, wanted, sign) == lowestCost) return static_cast<int>(i);
+    }
+    return 0;
+}
+#endif
+
+// Widest kernel the running CPU supports
+NearestCarKernel detectNearestCarKernel() {
+#ifdef ELEVATOR_HAS_AVX2_KERNEL
+    if (__builtin_cpu_supports("avx2")) return NearestCarKernel{"avx2", nearestCarAvx2};
+#endif
+#ifdef ELEVATOR_HAS_NEON_KERNEL
+    return NearestCarKernel{"neon", nearestCarNeon};
+#endif
+    return NearestCarKernel{"scalar", nearestCarScalar};
+}
+
+// Nearest-car selection run as a branch-free SIMD kernel over the FleetView
+class VectorizedNearestStrategy : public ElevatorSelectionStrategy {
+private:
+    NearestCarKernel kernel;
+
+public:
+    VectorizedNearestStrategy() : kernel(detectNearestCarKernel()) {}
+    explicit VectorizedNearestStrategy(NearestCarKernel k) : kernel(k) {}
+
+    const char* getKernelName() const { return kernel.name; }
+    const char* getName() const override { return "vectorized"; }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        vector<int> floors, states;
+        floors.reserve(elevators.size());
+        states.reserve(elevators.size());
+        for (Elevator* elevator : elevators) {
+            floors.push_back(elevator->getCurrentFloor());
+            states.push_back(static_cast<int>(elevator->getStateType()));
+        }
+        int selected = kernel.run(floors.data(), states.data(), elevators.size(), floor, direction);
+        return selected < 0 ? nullptr : elevators[selected];
+    }
+
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>&) override {
+        return kernel.run(fleet.currentFloor.data(), fleet.state.data(), fleet.size(), floor, direction);
+    }
+};
+
+// Destination dispatch: ranks cars by pickup distance plus a charge for every stop the
+// call would add. Passengers whose pickup and drop-off floors are already in a car's
+// plan ride together, so cars make fewer stops per trip.
+class DestinationDispatchStrategy : public ElevatorSelectionStrategy {
+private:
+    int stopCost;    // Cost of one extra stop, in floors of travel
+    NearestElevatorStrategy fallback;
+
+public:
+    explicit DestinationDispatchStrategy(int stopCostFloors = static_cast<int>(DOOR_DWELL_TIME / FLOOR_TRAVEL_TIME) + 1)
+        : stopCost(stopCostFloors) {}
+
+    const char* getName() const override { return "destination"; }
+    vector<double> getParameters() const override { return {static_cast<double>(stopCost)}; }
+    void setParameters(const vector<double>& parameters) override {
+        if (parameters.size() == 1) stopCost = static_cast<int>(parameters[0]);
+    }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        return fallback.selectElevator(floor, direction, elevators);
+    }
+
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>& elevators) override {
+        return fallback.selectElevatorIndex(floor, direction, fleet, elevators);
+    }
+
+    int selectElevatorForDestination(const HallCall& call, const FleetView& fleet,
+                                     const vector<Elevator*>& elevators) override {
+        const int sign = call.direction == Direction::UP ? 1 : -1;
+        const int wanted = wantedStateFor(call.direction);
+        int best = -1;
+        int bestCost = INT_MAX;
+        for (size_t i = 0; i < fleet.size(); i++) {
+            int offset = call.floor - fleet.currentFloor[i];
+            int cost = abs(offset);
+            bool onTheWay = fleet.state[i] == static_cast<int>(StateType::IDLE) ||
+                            (fleet.state[i] == wanted && offset * sign >= 0);
+            if (!onTheWay) {
+                // Has to finish its current route first, then travel back
+                cost = fleet.remainingFloors[i] + abs(call.floor - fleet.lastStop[i]);
+            }
+            if (!elevators[i]->willStopAt(call.floor)) cost += stopCost;
+            if (!elevators[i]->willStopAt(call.destinationFloor)) cost += stopCost;
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+};
+
+// Car motion model used for time estimates. Travel over n floors follows a trapezoidal
+// speed profile: n floors at cruising speed plus the time lost ramping up and down.
+struct Kinematics {
+    double floorHeight;     // metres
+    double maxSpeed;        // metres per second
+    double acceleration;    // metres per second squared, 0 for instant speed changes
+    SimTime doorDwell;      // milliseconds the doors stay open at each stop
+
+    // Defaults match the simulator's FLOOR_TRAVEL_TIME and DOOR_DWELL_TIME
+    Kinematics()
+        : floorHeight(4.0), maxSpeed(4.0 * 1000.0 / FLOOR_TRAVEL_TIME), acceleration(0.0),
+          doorDwell(DOOR_DWELL_TIME) {}
+
+    SimTime travelTime(int floors) const {
+        if (floors <= 0) return 0;
+        double distance = floors * floorHeight;
+        if (acceleration <= 0.0) return static_cast<SimTime>(1000.0 * distance / maxSpeed);
+        double rampDistance = maxSpeed * maxSpeed / acceleration;
+        double seconds = distance >= rampDistance ? distance / maxSpeed + maxSpeed / acceleration
+                                                  : 2.0 * sqrt(distance / acceleration);
+        return static_cast<SimTime>(1000.0 * seconds);
+    }
+
+    // Extra time an intermediate stop adds to a trip: dwell plus one more ramp cycle
+    SimTime stopTime() const {
+        SimTime ramp = acceleration > 0.0 ? static_cast<SimTime>(1000.0 * maxSpeed / acceleration) : 0;
+        return doorDwell + ramp;
+    }
+};
+
+// Cost-function dispatch: estimates how long each car would take to reach the call,
+// following its LOOK sweep through the stops it already has, and charges for the delay
+// the extra stop causes its passengers. The estimate reads counts straight from the
+// car's stop bitset, which is kept current as stops are added and removed, so it costs
+// a few word operations per car rather than a walk over its queue.
+class EtaCostStrategy : public ElevatorSelectionStrategy {
+private:
+    Kinematics kinematics;
+    double delayWeight;     // Weight of the delay imposed on stops after the new one
+    array<SimTime, MAX_FLOORS> travelByFloors;  // kinematics.travelTime, tabulated
+
+    void tabulate() {
+        for (int floors = 0; floors < MAX_FLOORS; floors++) {
+            travelByFloors[static_cast<size_t>(floors)] = kinematics.travelTime(floors);
+        }
+    }
+
+public:
+    explicit EtaCostStrategy(const Kinematics& k = Kinematics(), double delayWeight = 1.0)
+        : kinematics(k), delayWeight(delayWeight) {
+        tabulate();
+    }
+
+    const Kinematics& getKinematics() const { return kinematics; }
+
+    const char* getName() const override { return "eta"; }
+    vector<double> getParameters() const override {
+        return {kinematics.floorHeight, kinematics.maxSpeed, kinematics.acceleration,
+                static_cast<double>(kinematics.doorDwell), delayWeight};
+    }
+    void setParameters(const vector<double>& parameters) override {
+        if (parameters.size() != 5) return;
+        kinematics.floorHeight = parameters[0];
+        kinematics.maxSpeed = parameters[1];
+        kinematics.acceleration = parameters[2];
+        kinematics.doorDwell = static_cast<SimTime>(parameters[3]);
+        delayWeight = parameters[4];
+        tabulate();
+    }
+
+    // Time until the car opens its doors at `floor` for a call travelling `direction`
+    SimTime estimateTimeToServe(const Elevator& car, int floor, Direction direction) const {
+        int path = 0;
+        int stopsBefore = 0;
+        estimateRoute(car, floor, direction, path, stopsBefore);
+        SimTime eta = kinematics.travelTime(path) + stopsBefore * kinematics.stopTime();
+        if (car.areDoorsOpen()) eta += kinematics.doorDwell;
+        return eta;
+    }
+
+    double cost(const Elevator& car, int floor, Direction direction) const {
+        int path = 0;
+        int stopsBefore = 0;
+        estimateRoute(car, floor, direction, path, stopsBefore);
+        double eta = static_cast<double>(kinematics.travelTime(path) + stopsBefore * kinematics.stopTime());
+        if (car.areDoorsOpen()) eta += kinematics.doorDwell;
+        const StopSet& stops = car.getPendingStops();
+        if (!stops.contains(floor)) {
+            int stopsAfter = static_cast<int>(stops.size()) - stopsBefore;
+            eta += delayWeight * stopsAfter * kinematics.stopTime();
+        }
+        return eta;
+    }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        Elevator* best = nullptr;
+        double bestCost = 0.0;
+        for (Elevator* elevator : elevators) {
+            double carCost = cost(*elevator, floor, direction);
+            if (!best || carCost < bestCost) {
+                best = elevator;
+                bestCost = carCost;
+            }
+        }
+        return best;
+    }
+
+    // No car reaches the call sooner than the straight run from its FleetView floor, so
+    // the nearest car sets a bar and only cars whose bound still clears it are costed
+    // in full. Picks the same car, ties included, as costing every car.
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>& elevators) override {
+        const size_t cars = elevators.size();
+        if (cars == 0) return -1;
+        if (delayWeight < 0.0 || fleet.size() != cars) return selectByFullCost(floor, direction, elevators);
+        size_t nearest = 0;
+        for (size_t i = 1; i < cars; i++) {
+            if (abs(floor - fleet.currentFloor[i]) < abs(floor - fleet.currentFloor[nearest])) nearest = i;
+        }
+        size_t best = nearest;
+        double bestCost = cost(*elevators[nearest], floor, direction);
+        for (size_t i = 0; i < cars; i++) {
+            if (i == nearest) continue;
+            int distance = min(abs(floor - fleet.currentFloor[i]), MAX_FLOORS - 1);
+            double bound = static_cast<double>(travelByFloors[static_cast<size_t>(distance)]);
+            if (bound > bestCost || (bound == bestCost && i > best)) continue;
+            double carCost = cost(*elevators[i], floor, direction);
+            if (carCost < bestCost || (carCost == bestCost && i < best)) {
+                best = i;
+                bestCost = carCost;
+            }
+        }
+        return static_cast<int>(best);
+    }
+
+private:
+    int selectByFullCost(int floor, Direction direction, const vector<Elevator*>& elevators) const {
+        int best = -1;
+        double bestCost = 0.0;
+        for (size_t i = 0; i < elevators.size(); i++) {
+            double carCost = cost(*elevators[i], floor, direction);
+            if (best < 0 || carCost < bestCost) {
+                best = static_cast<int>(i);
+                bestCost = carCost;
+            }
+        }
+        return best;
+    }
+
+    // Floors travelled and stops made before the car reaches `floor`
+    void estimateRoute(const Elevator& car, int floor, Direction direction, int& path, int& stopsBefore) const {
+        const StopSet& stops = car.getPendingStops();
+        const int current = car.getCurrentFloor();
+        if (stops.empty()) {
+            path = abs(floor - current);
+            stopsBefore = 0;
+            return;
+        }
+
+        // LOOK reverses when nothing is left ahead, so use the direction it will really take
+        bool up = car.getSweepDirection() == Direction::UP;
+        if (up && stops.nextAbove(current - 1) == NO_FLOOR) up = false;
+        else if (!up && stops.nextBelow(current + 1) == NO_FLOOR) up = true;
+
+        if (up) {
+            int turn = max(stops.highest(), current);
+            bool onThisSweep = floor >= current &&
+                               (direction == Direction::UP || floor >= turn || stops.contains(floor));
+            if (onThisSweep) {
+                path = floor - current;
+                stopsBefore = stops.countBetween(current + 1, floor - 1);
+            } else {
+                path = (turn - current) + (turn - floor);
+                stopsBefore = stops.countBetween(current + 1, turn) +
+                              stops.countBetween(floor + 1, min(current, turn - 1));
+            }
+        } else {
+            int turn = min(stops.lowest(), current);
+            bool onThisSweep = floor <= current &&
+                               (direction == Direction::DOWN || floor <= turn || stops.contains(floor));
+            if (onThisSweep) {
+                path = current - floor;
+                stopsBefore = stops.countBetween(floor + 1, current - 1);
+            } else {
+                path = (current - turn) + (floor - turn);
+                stopsBefore = stops.countBetween(turn, current - 1) +
+                              stops.countBetween(max(current, turn + 1), floor - 1);
+            }
+        }
+    }
+};
+
+// Load-aware dispatch: defers to another strategy but never hands a call to a car whose
+// load weighing reports it full. Such a car would only pass the floor and bounce the
+// call back; the nearest car with room by remaining route takes it instead.
+class LoadAwareStrategy : public ElevatorSelectionStrategy {
+private:
+    unique_ptr<ElevatorSelectionStrategy> inner;
+
+    static int nearestWithRoom(int floor, const FleetView& fleet) {
+        int best = -1;
+        int bestCost = INT_MAX;
+        for (size_t i = 0; i < fleet.size(); i++) {
+            if (fleet.full[i]) continue;
+            int cost = abs(floor - fleet.currentFloor[i]) + fleet.remainingFloors[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = static_cast<int>(i);
+            }
+        }
+        return best;
+    }
+
+    static int checked(int selected, int floor, const FleetView& fleet) {
+        if (selected < 0 || !fleet.full[static_cast<size_t>(selected)]) return selected;
+        int alternative = nearestWithRoom(floor, fleet);
+        return alternative >= 0 ? alternative : selected;  // Everyone is full: queue behind the pick
+    }
+
+public:
+    explicit LoadAwareStrategy(unique_ptr<ElevatorSelectionStrategy> innerStrategy =
+                                   unique_ptr<ElevatorSelectionStrategy>(new EtaCostStrategy()))
+        : inner(std::move(innerStrategy)) {}
+
+    // Only the default ETA inner strategy comes back by name; its parameters pass through
+    const char* getName() const override { return strcmp(inner->getName(), "eta") == 0 ? "load" : "custom"; }
+    vector<double> getParameters() const override { return inner->getParameters(); }
+    void setParameters(const vector<double>& parameters) override { inner->setParameters(parameters); }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        Elevator* selected = inner->selectElevator(floor, direction, elevators);
+        if (!selected || !selected->isFull()) return selected;
+        Elevator* best = nullptr;
+        int bestDistance = INT_MAX;
+        for (Elevator* elevator : elevators) {
+            int distance = abs(floor - elevator->getCurrentFloor());
+            if (!elevator->isFull() && distance < bestDistance) {
+                best = elevator;
+                bestDistance = distance;
+            }
+        }
+        return best ? best : selected;
+    }
+
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>& elevators) override {
+        return checked(inner->selectElevatorIndex(floor, direction, fleet, elevators), floor, fleet);
+    }
+
+    int selectElevatorForDestination(const HallCall& call, const FleetView& fleet,
+                                     const vector<Elevator*>& elevators) override {
+        return checked(inner->selectElevatorForDestination(call, fleet, elevators), call.floor, fleet);
+    }
+};
+
+// Optimal batch assignment: prices every pending call of a dispatch cycle on every
+// car and solves the assignment for the least total cost with the Hungarian method.
+// Calls at the same floor share one stop and form one row. A car can take several
+// rows: its k-th new stop in the batch is charged k stop times, the delay it adds to
+// the ones before it. Rows are solved one augmenting path at a time against a hard
+// time budget, and rows left when it runs out fall back to a greedy pick, so a cycle
+// never takes much longer than the budget.
+class BatchAssignmentStrategy : public ElevatorSelectionStrategy {
+private:
+    EtaCostStrategy estimator;     // Single-call picks and per-car cost estimates
+    chrono::microseconds budget;
+    double slotWeight;             // Weight of the delay new stops in one batch impose on each other
+    unsigned long long solved;     // Batches finished within budget
+    unsigned long long overruns;   // Batches that fell back to greedy for some rows
+
+    vector<int> rowFloor;          // Reused between cycles
+    vector<Direction> rowDirection;
+    vector<double> rowCost;        // rows x cars base costs
+    vector<int> rowOf;             // Row of each call, -1 if unassignable
+    vector<int> rowDestinations;   // Destination floors of each call, grouped by row below
+
+public:
+    explicit BatchAssignmentStrategy(chrono::microseconds timeBudget = chrono::microseconds(500),
+                                     double slotWeight = 1.0)
+        : budget(timeBudget), slotWeight(slotWeight), solved(0), overruns(0) {}
+
+    const char* getName() const override { return "batch"; }
+    vector<double> getParameters() const override { return {static_cast<double>(budget.count()), slotWeight}; }
+    void setParameters(const vector<double>& parameters) override {
+        if (parameters.size() != 2) return;
+        budget = chrono::microseconds(static_cast<long long>(parameters[0]));
+        slotWeight = parameters[1];
+    }
+
+    unsigned long long getSolvedCount() const { return solved; }
+    unsigned long long getOverrunCount() const { return overruns; }
+
+    Elevator* selectElevator(int floor, Direction direction, const vector<Elevator*>& elevators) override {
+        return estimator.selectElevator(floor, direction, elevators);
+    }
+
+    int selectElevatorIndex(int floor, Direction direction, const FleetView& fleet,
+                            const vector<Elevator*>& elevators) override {
+        return estimator.selectElevatorIndex(floor, direction, fleet, elevators);
+    }
+
+    void selectElevatorBatch(const HallCall* calls, size_t count, const FleetView& fleet,
+                             const vector<Elevator*>& elevators, int* assignments) override {
+        const auto deadline = chrono::steady_clock::now() + budget;
+        const size_t cars = elevators.size();
+        rowFloor.clear();
+        rowDirection.clear();
+        rowOf.assign(count, -1);
+        // One row per (floor, direction), so opposite calls at a floor are costed apart
+        array<int, 2 * MAX_FLOORS> rowAtKey;
+        rowAtKey.fill(-1);
+        for (size_t c = 0; c < count; c++) {
+            assignments[c] = -1;
+            int floor = calls[c].floor;
+            if (cars == 0 || !StopSet::inRange(floor)) continue;
+            int& row = rowAtKey[static_cast<size_t>(floor * 2 + static_cast<int>(calls[c].direction))];
+            if (row < 0) {
+                row = static_cast<int>(rowFloor.size());
+                rowFloor.push_back(floor);
+                rowDirection.push_back(calls[c].direction);
+            }
+            rowOf[c] = row;
+        }
+        const size_t rows = rowFloor.size();
+        if (rows == 0) return;
+        vector<size_t> destinationStart(rows + 1, 0);
+        for (size_t c = 0; c < count; c++) {
+            if (rowOf[c] >= 0 && calls[c].hasDestination()) destinationStart[static_cast<size_t>(rowOf[c]) + 1]++;
+        }
+        for (size_t row = 0; row < rows; row++) destinationStart[row + 1] += destinationStart[row];
+        rowDestinations.resize(destinationStart[rows]);
+        vector<size_t> fillAt(destinationStart.begin(), destinationStart.end() - 1);
+        for (size_t c = 0; c < count; c++) {
+            if (rowOf[c] >= 0 && calls[c].hasDestination()) {
+                rowDestinations[fillAt[static_cast<size_t>(rowOf[c])]++] = calls[c].destinationFloor;
+            }
+        }
+
+        // Full cars get a prohibitive cost rather than none, so a full fleet still queues
+        const double stopTime = static_cast<double>(estimator.getKinematics().stopTime());
+        const double slotTime = slotWeight * stopTime;
+        const double blocked = 1e12;
+        rowCost.resize(rows * cars);
+        for (size_t r = 0; r < rows; r++) {
+            for (size_t i = 0; i < cars; i++) {
+                double cost = estimator.cost(*elevators[i], rowFloor[r], rowDirection[r]);
+                // Each destination the car does not already stop at costs one more stop
+                for (size_t d = destinationStart[r]; d < destinationStart[r + 1]; d++) {
+                    if (!elevators[i]->willStopAt(rowDestinations[d])) cost += stopTime;
+                }
+                rowCost[r * cars + i] = fleet.full[i] ? cost + blocked : cost;
+            }
+        }
+        // Columns are (car, slot) pairs: column k * cars + i is car i's k-th new stop.
+        // Slots are capped at twice an even share; past that the slot charge rules a
+        // car out anyway, and the cap keeps the matrix near rows x (2 rows) wide.
+        const size_t slots = min(rows, 2 * ((rows + cars - 1) / cars) + 1);
+        const size_t columns = slots * cars;
+        auto cost = [&](size_t r, size_t column) {
+            size_t car = column % cars;
+            double base = rowCost[r * cars + car];
+            if (elevators[car]->hasPendingStop(rowFloor[r])) return base;  // No new stop
+            return base + static_cast<double>(column / cars) * slotTime;
+        };
+
+        // Shortest augmenting path Hungarian method, 1-based with a virtual column 0
+        vector<double> u(rows + 1, 0.0), v(columns + 1, 0.0), minTo(columns + 1);
+        vector<size_t> rowAt(columns + 1, 0), way(columns + 1, 0);
+        vector<char> used(columns + 1);
+        size_t r = 1;
+        for (; r <= rows; r++) {
+            if (r > 1 && chrono::steady_clock::now() >= deadline) break;
+            rowAt[0] = r;
+            size_t column = 0;
+            fill(minTo.begin(), minTo.end(), numeric_limits<double>::infinity());
+            fill(used.begin(), used.end(), 0);
+            do {
+                used[column] = 1;
+                size_t row = rowAt[column], next = 0;
+                double delta = numeric_limits<double>::infinity();
+                for (size_t j = 1; j <= columns; j++) {
+                    if (used[j]) continue;
+                    double reduced = cost(row - 1, j - 1) - u[row] - v[j];
+                    if (reduced < minTo[j]) {
+                        minTo[j] = reduced;
+                        way[j] = column;
+                    }
+                    if (minTo[j] < delta) {
+                        delta = minTo[j];
+                        next = j;
+                    }
+                }
+                for (size_t j = 0; j <= columns; j++) {
+                    if (used[j]) {
+                        u[rowAt[j]] += delta;
+                        v[j] -= delta;
+                    } else {
+                        minTo[j] -= delta;
+                    }
+                }
+                column = next;
+            } while (rowAt[column] != 0);
+            do {
+                size_t previous = way[column];
+                rowAt[column] = rowAt[previous];
+                column = previous;
+            } while (column != 0);
+        }
+
+        vector<int> carOfRow(rows, -1);
+        vector<int> newStops(cars, 0);
+        for (size_t j = 1; j <= columns; j++) {
+            if (rowAt[j] == 0 || rowAt[j] >= r) continue;
+            size_t car = (j - 1) % cars;
+            carOfRow[rowAt[j] - 1] = static_cast<int>(car);
+            if (!elevators[car]->hasPendingStop(rowFloor[rowAt[j] - 1])) newStops[car]++;
+        }
+        if (r <= rows) {
+            // Out of time: each remaining row takes the cheapest car given the stops so far
+            overruns++;
+            for (size_t row = r - 1; row < rows; row++) {
+                int best = -1;
+                double bestCost = 0.0;
+                for (size_t car = 0; car < cars; car++) {
+                    bool newStop = !elevators[car]->hasPendingStop(rowFloor[row]);
+                    double carCost = rowCost[row * cars + car] + (newStop ? newStops[car] * slotTime : 0.0);
+                    if (best < 0 || carCost < bestCost) {
+                        best = static_cast<int>(car);
+                        bestCost = carCost;
+                    }
+                }
+                carOfRow[row] = best;
+                if (!elevators[static_cast<size_t>(best)]->hasPendingStop(rowFloor[row])) newStops[static_cast<size_t>(best)]++;
+            }
+        } else {
+            solved++;
+        }
+        for (size_t c = 0; c < count; c++) {
+            if (rowOf[c] >= 0) assignments[c] = carOfRow[static_cast<size_t>(rowOf[c])];
+        }
+    }
+};
+
+// Parking: where an idle car waits for its next call. The manager reports every call
+// it dispatches, and asks for a floor each time a car runs out of work.
+class ParkingStrategy {
+public:
+    virtual void recordCall(int, SimTime) {}
+
+    // Floor for the idle car at fleet index `car`, or NO_FLOOR to leave it where it is
+    virtual int selectParkingFloor(int car, const FleetView& fleet, const vector<Elevator*>& elevators,
+                                   SimTime now) = 0;
+
+    virtual ~ParkingStrategy() = default;
+};
+
+// Per-floor call counts where each call's weight halves every `halfLife` ms. Weights
+// are stored relative to a reference time rather than decayed in place, so adding a
+// call is O(1) and shares need no clock; the reference moves forward only when the
+// newest weights grow too large for a double.
+class DecayingHistogram {
+private:
+    vector<double> weights;
+    double total;
+    double halfLife;
+    SimTime reference;
+
+public:
+    explicit DecayingHistogram(double halfLifeMs = 3600000.0, size_t bins = MAX_FLOORS)
+        : weights(bins, 0.0), total(0.0), halfLife(max(halfLifeMs, 1.0)), reference(0) {}
+
+    void add(int bin, SimTime time) {
+        if (bin < 0 || static_cast<size_t>(bin) >= weights.size()) return;
+        double weight = exp2(static_cast<double>(time - reference) / halfLife);
+        if (weight > 1e100) {
+            double scale = 1.0 / weight;
+            for (double& w : weights) w *= scale;
+            total *= scale;
+            reference = time;
+            weight = 1.0;
+        }
+        weights[static_cast<size_t>(bin)] += weight;
+        total += weight;
+    }
+
+    // Fraction of the decayed weight at `bin`
+    double share(int bin) const {
+        return total > 0.0 ? weights[static_cast<size_t>(bin)] / total : 0.0;
+    }
+
+    // Calls still counted at `time` after decay
+    double effectiveCount(SimTime time) const {
+        return total * exp2(static_cast<double>(reference - time) / halfLife);
+    }
+
+    size_t bins() const { return weights.size(); }
+};
+
+// Predictive parking: learns where calls come from at each time of day and sends idle
+// cars to the hottest floors no other idle car already covers, such as the lobby
+// during the morning up-peak. Simulated time 0 is midnight. Each time-of-day slot keeps
+// its own histogram, decayed over days, and a short-term histogram fills in for slots
+// that have no history yet.
+class PredictiveParkingStrategy : public ParkingStrategy {
+private:
+    SimTime slotLength;
+    size_t slots;
+    vector<DecayingHistogram> timeOfDay;   // By slot
+    DecayingHistogram recent;
+    double minShare;                       // Below this predicted share a floor is not worth a trip
+    double confidentCalls;                 // Slot history at which it outweighs recent calls
+
+    static const SimTime DAY = 24LL * 3600 * 1000;
+
+    size_t slotOf(SimTime time) const {
+        return static_cast<size_t>((time % DAY) / slotLength) % slots;
+    }
+
+public:
+    explicit PredictiveParkingStrategy(SimTime slotMs = 15 * 60 * 1000, double historyHalfLifeMs = 2.0 * DAY,
+                                       double recentHalfLifeMs = 10 * 60 * 1000, double minShare = 0.05)
+        : slotLength(max<SimTime>(slotMs, 1000)),
+          slots(static_cast<size_t>((DAY + slotLength - 1) / slotLength)),
+          timeOfDay(slots, DecayingHistogram(historyHalfLifeMs)), recent(recentHalfLifeMs),
+          minShare(minShare), confidentCalls(20.0) {}
+
+    void recordCall(int floor, SimTime time) override {
+        timeOfDay[slotOf(time)].add(floor, time);
+        recent.add(floor, time);
+    }
+
+    // How far the time-of-day history is trusted over recent calls at `now`
+    double confidence(SimTime now) const {
+        return min(1.0, timeOfDay[slotOf(now)].effectiveCount(now) / confidentCalls);
+    }
+
+    // Predicted share of the calls `floor` will see around `now`
+    double predictedShare(int floor, SimTime now, double trust) const {
+        return trust * timeOfDay[slotOf(now)].share(floor) + (1.0 - trust) * recent.share(floor);
+    }
+
+    int selectParkingFloor(int car, const FleetView& fleet, const vector<Elevator*>& elevators,
+                           SimTime now) override {
+        array<char, MAX_FLOORS> covered{};
+        for (size_t i = 0; i < elevators.size(); i++) {
+            if (static_cast<int>(i) == car) continue;
+            if (elevators[i]->getParkingFloor() != NO_FLOOR) {
+                covered[static_cast<size_t>(elevators[i]->getParkingFloor())] = 1;
+            } else if (elevators[i]->isVacant()) {
+                covered[static_cast<size_t>(fleet.currentFloor[i])] = 1;
+            }
+        }
+        const int from = fleet.currentFloor[static_cast<size_t>(car)];
+        int best = NO_FLOOR;
+        double bestShare = minShare;
+        const double trust = confidence(now);
+        for (int floor = 0; floor < MAX_FLOORS; floor++) {
+            if (covered[static_cast<size_t>(floor)]) continue;
+            double share = predictedShare(floor, now, trust);
+            // Ties go to the floor nearer the car
+            if (share > bestShare || (share == bestShare && best != NO_FLOOR &&
+                                      abs(floor - from) < abs(best - from))) {
+                best = floor;
+                bestShare = share;
+            }
+        }
+        return best;
+    }
+};
+
+// Concrete States (stateless flyweights, one shared instance each)
+class IdleState : public State {
+public:
+    static IdleState* instance() { static IdleState state; return &state; }
+    void moveUp(Elevator& elevator) override;
+    void moveDown(Elevator& elevator) override;
+    void stop(Elevator&) override {} // Already idle
+    StateType getType() const override { return StateType::IDLE; }
+};
+
+class MovingUpState : public State {
+public:
+    static MovingUpState* instance() { static MovingUpState state; return &state; }
+    void moveUp(Elevator&) override {} // Continue moving up
+    void moveDown(Elevator& elevator) override;
+    void stop(Elevator& elevator) override;
+    StateType getType() const override { return StateType::MOVING_UP; }
+};
+
+class MovingDownState : public State {
+public:
+    static MovingDownState* instance() { static MovingDownState state; return &state; }
+    void moveUp(Elevator& elevator) override;
+    void moveDown(Elevator&) override {} // Continue moving down
+    void stop(Elevator& elevator) override;
+    StateType getType() const override { return StateType::MOVING_DOWN; }
+};
+
+// Parked by a fault or for maintenance; only ElevatorManager::returnToService moves it on
+class OutOfServiceState : public State {
+public:
+    static OutOfServiceState* instance() { static OutOfServiceState state; return &state; }
+    void moveUp(Elevator&) override {}
+    void moveDown(Elevator&) override {}
+    void stop(Elevator&) override {}
+    StateType getType() const override { return StateType::OUT_OF_SERVICE; }
+};
+
+State* getBuiltinState(StateType type) {
+    switch(type) {
+        case StateType::MOVING_UP: return MovingUpState::instance();
+        case StateType::MOVING_DOWN: return MovingDownState::instance();
+        case StateType::OUT_OF_SERVICE: return OutOfServiceState::instance();
+        case StateType::IDLE:
+        default: return IdleState::instance();
+    }
+}
+
+// Stable references to manager-built objects, valid for the manager's lifetime
+struct ElevatorHandle {
+    int index;                     // Fleet index
+};
+
+struct PanelHandle {
+    int index;                     // Position in the manager's panel list
+};
+
+// Manager Class
+class ElevatorManager {
+private:
+    vector<Elevator*> elevators;   // Fleet order; points into ownedElevators or at caller-owned cars
+    vector<OuterPanel*> panels;
+    vector<InnerPanel*> innerPanels;  // By fleet index; nullptr for cars added from outside
+    vector<ElevatorObserver*> observers;
+    ObjectArena<Elevator> ownedElevators;
+    ObjectArena<OuterPanel> ownedPanels;
+    ObjectArena<InnerPanel> ownedInnerPanels;
+    unique_ptr<ElevatorSelectionStrategy> selectionStrategy;
+    unique_ptr<ParkingStrategy> parkingStrategy;  // nullptr: idle cars stay where they stop
+    TripObserver* tripObserver;
+    EventLogWriter* eventLog;
+#if ELEVATOR_METRICS
+    ElevatorMetrics metrics;
+#endif
+    ObjectPool<Passenger> passengerPool;
+    EventQueue events;
+    FleetView fleet;
+    MpscQueue<HallCall> intake;    // Hall calls from panels on any thread
+    vector<HallCall> intakeBatch;  // Reused by drainIntake
+    vector<EventQueue> shards;     // Per-shard car events, only during runParallel
+    size_t carsPerShard;
+
+    // Targeted observers: notified only about the cars or floors they subscribed to
+    struct Notification {
+        int subscriber;
+        int floor;
+        StateType state;
+    };
+    vector<ElevatorObserver*> subscribers;       // By subscriber id, nullptr once unsubscribed
+    unordered_map<ElevatorObserver*, int> subscriberIds;
+    vector<vector<int>> carSubscribers;          // Subscriber ids per fleet index
+    vector<vector<int>> floorSubscribers;        // Subscriber ids per floor
+    vector<char> dirtyCars;                      // Set by each car on its own slot only
+    atomic<bool> notificationsPending;
+    vector<Notification> coalesced;              // At most one entry per subscriber
+    vector<int> coalescedSlot;                   // Subscriber id -> index in coalesced, or -1
+
+    // Re-dispatch of hall calls not yet served
+    vector<char> redispatchDirty;                // Like dirtyCars, cleared by each pass
+    struct PendingAssignment {
+        int floor;
+        Direction direction;
+        int car;                                 // Fleet index
+        double cost;                             // Estimated cost at `car` when last evaluated
+    };
+    vector<PendingAssignment> assignments;
+    vector<int> assignmentSlot;                  // floor * 2 + direction -> index in assignments, or -1
+    SimTime redispatchInterval;                  // 0: assignments are final
+    SimTime nextRedispatch;
+    double redispatchHysteresis;                 // Minimum improvement, ms, before a call moves
+    EtaCostStrategy redispatchCost;
+    unsigned long long redispatched;
+
+    // Cars out of service are hidden from the strategy behind a compacted copy of the
+    // fleet. It is rebuilt when a car leaves or rejoins and otherwise kept current by
+    // updateFleetSlot, so dispatch costs the same as with the whole fleet up.
+    size_t outOfService;
+    vector<Elevator*> serviceCars;
+    FleetView serviceFleet;
+    vector<int> serviceIndex;                    // serviceCars slot -> fleet index
+    vector<int> serviceSlot;                     // Fleet index -> serviceCars slot, or -1
+    unsigned long long migrated;
+
+    void trackAssignment(int floor, Direction direction, int car);
+    void dropAssignment(size_t index);
+    void redispatch();
+
+    // Every strategy call goes through these; they return fleet indices
+    void rebuildServiceView();
+    int selectFor(int floor, Direction direction);
+    int selectForDestination(const HallCall& call);
+    void selectBatch(const HallCall* calls, size_t count, int* selected);
+
+    int subscriberId(ElevatorObserver* observer);
+    void queueNotification(int subscriber, int floor, StateType state);
+
+    void dispatch(const Event& event);
+
+    EventQueue& queueFor(const Elevator* elevator);
+
+    // Shard whose events the current thread is processing, if any
+    static const EventQueue*& runningShard() {
+        static thread_local const EventQueue* shard = nullptr;
+        return shard;
+    }
+
+public:
+    ElevatorManager()
+        : selectionStrategy(new NearestElevatorStrategy()), tripObserver(nullptr), eventLog(nullptr), intake(HALL_CALL_INTAKE_CAPACITY),
+          carsPerShard(1), floorSubscribers(MAX_FLOORS), notificationsPending(false),
+          assignmentSlot(2 * MAX_FLOORS, -1), redispatchInterval(0), nextRedispatch(0),
+          redispatchHysteresis(DOOR_DWELL_TIME), redispatched(0), outOfService(0), migrated(0) {
+        LOG_INFO("Elevator Manager created");
+    }
+
+    ~ElevatorManager();
+
+    ElevatorManager(const ElevatorManager&) = delete;
+    ElevatorManager& operator=(const ElevatorManager&) = delete;
+
+    void setSelectionStrategy(unique_ptr<ElevatorSelectionStrategy> strategy) {
+        selectionStrategy = std::move(strategy);
+    }
+
+    void setParkingStrategy(unique_ptr<ParkingStrategy> strategy) {
+        parkingStrategy = std::move(strategy);
+    }
+
+    bool hasParkingStrategy() const { return parkingStrategy != nullptr; }
+
+    // Every `interval` of simulated time, hall calls not yet served may move to a car
+    // that has since become at least `hysteresis` ms cheaper. 0 turns it off.
+    void setRedispatchInterval(SimTime interval, double hysteresis = DOOR_DWELL_TIME) {
+        redispatchInterval = max<SimTime>(0, interval);
+        redispatchHysteresis = hysteresis;
+        nextRedispatch = getTime() + redispatchInterval;
+        if (redispatchInterval == 0) {
+            for (const PendingAssignment& assignment : assignments) {
+                assignmentSlot[static_cast<size_t>(assignment.floor * 2 + static_cast<int>(assignment.direction))] = -1;
+            }
+            assignments.clear();
+        }
+    }
+
+    unsigned long long getRedispatchCount() const { return redispatched; }
+    size_t getPendingAssignmentCount() const { return assignments.size(); }
+
+    // Not owned; nullptr to stop reporting
+    void setTripObserver(TripObserver* observer) { tripObserver = observer; }
+    TripObserver* getTripObserver() const { return tripObserver; }
+
+    // Not owned; records calls and every car's transitions until reset to nullptr
+    void setEventLog(EventLogWriter* log) { eventLog = log; }
+    EventLogWriter* getEventLog() const { return eventLog; }
+
+    // Builds `count` manager-owned cars with consecutive ids in a single allocation.
+    // Their handles are consecutive, starting with the one returned.
+    ElevatorHandle createElevators(int count, int firstId = 1) {
+        ElevatorHandle first{static_cast<int>(elevators.size())};
+        size_t total = elevators.size() + static_cast<size_t>(count);
+        ownedElevators.reserve(static_cast<size_t>(count));
+        ownedInnerPanels.reserve(static_cast<size_t>(count));
+        elevators.reserve(total);
+        fleet.reserve(total);
+        carSubscribers.reserve(total);
+        dirtyCars.reserve(total);
+        redispatchDirty.reserve(total);
+        for (int i = 0; i < count; i++) {
+            addElevator(ownedElevators.create(firstId + i, this));
+            addInnerPanel(*elevators.back());
+        }
+        return first;
+    }
+
+    ElevatorHandle createElevator(int id) { return createElevators(1, id); }
+
+    // Builds one manager-owned panel per floor in [lowestFloor, highestFloor]
+    PanelHandle createPanels(int lowestFloor, int highestFloor);
+
+    Elevator& getElevator(ElevatorHandle handle) { return *elevators[static_cast<size_t>(handle.index)]; }
+    OuterPanel& getPanel(PanelHandle handle) { return *panels[static_cast<size_t>(handle.index)]; }
+    // The car's own buttons; nullptr for a car added through addElevator or a bad handle,
+    // since only cars built by createElevators have one
+    InnerPanel* getInnerPanel(ElevatorHandle handle) {
+        if (handle.index < 0 || static_cast<size_t>(handle.index) >= innerPanels.size()) return nullptr;
+        return innerPanels[static_cast<size_t>(handle.index)];
+    }
+
+    void addToQueue(int floor, Direction direction) {
+        if (!StopSet::inRange(floor)) {
+            LOG_WARN("Ignoring request for invalid floor " << floor);
+            return;
+        }
+        ELEVATOR_METRIC_TIMER(timer, metrics.dispatchLatency, 1);
+        ELEVATOR_METRIC(metrics.hallCalls.fetch_add(1, memory_order_relaxed));
+        LOG_INFO("Request received for floor " << floor);
+        if (eventLog) {
+            eventLog->append(makeLogRecord(getTime(), LogRecordKind::HALL_CALL, 0, floor, static_cast<int>(direction)));
+        }
+        if (parkingStrategy) parkingStrategy->recordCall(floor, getTime());
+        int selected = selectFor(floor, direction);
+        if (selected >= 0) {
+            elevators[selected]->addToQueue(floor);
+            if (redispatchInterval > 0) trackAssignment(floor, direction, selected);
+        }
+    }
+
+    // Thread-safe entry point for panels; returns false if the intake queue is full.
+    // Calls are dispatched by whichever thread drives the simulation.
+    bool submitHallCall(int floor, Direction direction) {
+        return intake.tryPush(HallCall{floor, direction});
+    }
+
+    // Dispatches every call submitted so far; must only run on the simulation thread
+    size_t drainIntake() {
+        intakeBatch.clear();
+        HallCall call;
+        size_t drained = 0;
+        while (intake.tryPop(call)) {
+            drained++;
+            if (call.isIdleNotice()) {
+                parkIdleCar(call.carIndex);
+            } else if (call.passenger) {
+                reassignPassenger(call.passenger);
+            } else if (call.isCarCall()) {
+                addCarCall(call.carIndex, call.floor);
+            } else if (call.hasDestination()) {
+                addDestinationCall(call.floor, call.destinationFloor);
+            } else {
+                intakeBatch.push_back(call);
+            }
+        }
+        if (intakeBatch.size() == 1) {
+            addToQueue(intakeBatch[0].floor, intakeBatch[0].direction);
+        } else {
+            addToQueueBatch(intakeBatch);
+        }
+        // Every dispatch boundary passes through here, so re-dispatch rides along
+        if (redispatchInterval > 0 && getTime() >= nextRedispatch) {
+            nextRedispatch = getTime() + redispatchInterval;
+            redispatch();
+        }
+        return drained;
+    }
+
+    Passenger* acquirePassenger(int passengerId, int sourceFloor, int destinationFloor) {
+        return passengerPool.acquire(Passenger{passengerId, sourceFloor, destinationFloor, getTime(), NOMINAL_PASSENGER_KG});
+    }
+
+    void releasePassenger(Passenger* passenger) { passengerPool.release(passenger); }
+
+    size_t getPassengersInSystem() { return passengerPool.inUse(); }
+
+    // Thread-safe: queues a passenger a car could not take for re-dispatch
+    bool submitPassenger(Passenger* passenger) {
+        Direction direction = passenger->destinationFloor > passenger->sourceFloor ? Direction::UP : Direction::DOWN;
+        return intake.tryPush(HallCall{passenger->sourceFloor, direction, passenger->destinationFloor, -1, passenger});
+    }
+
+    // Picks a car for a passenger that keeps its trip id and original call time
+    void reassignPassenger(Passenger* passenger) {
+        Direction direction = passenger->destinationFloor > passenger->sourceFloor ? Direction::UP : Direction::DOWN;
+        int selected = selectForDestination(HallCall{passenger->sourceFloor, direction, passenger->destinationFloor});
+        if (selected < 0) {
+            releasePassenger(passenger);
+            return;
+        }
+        elevators[static_cast<size_t>(selected)]->assignPassenger(passenger);
+    }
+
+    // Thread-safe: a car reports it has run out of work, see parkIdleCar
+    bool submitIdleCar(int fleetIndex) {
+        return intake.tryPush(HallCall{NO_FLOOR, Direction::UP, NO_FLOOR, fleetIndex});
+    }
+
+    // Sends a car that is still vacant to the floor the parking strategy picks
+    void parkIdleCar(int fleetIndex) {
+        if (!parkingStrategy || fleetIndex < 0 || static_cast<size_t>(fleetIndex) >= elevators.size()) return;
+        Elevator& car = *elevators[static_cast<size_t>(fleetIndex)];
+        if (!car.isVacant()) return;  // Took a call since reporting
+        int floor = parkingStrategy->selectParkingFloor(fleetIndex, fleet, elevators, getTime());
+        if (floor != NO_FLOOR) car.parkAt(floor);
+    }
+
+    // Thread-safe car-call entry point for a car's inner panel, see submitHallCall
+    bool submitCarCall(int fleetIndex, int floor) {
+        return intake.tryPush(HallCall{floor, Direction::UP, NO_FLOOR, fleetIndex});
+    }
+
+    // Car calls bypass the strategy: the passenger is already in that car
+    void addCarCall(int fleetIndex, int floor) {
+        if (fleetIndex < 0 || static_cast<size_t>(fleetIndex) >= elevators.size()) return;
+        elevators[static_cast<size_t>(fleetIndex)]->addCarCall(floor);
+    }
+
+    // Thread-safe destination-dispatch entry point, see submitHallCall
+    bool submitDestinationCall(int sourceFloor, int destinationFloor) {
+        if (sourceFloor == destinationFloor) return true;
+        Direction direction = destinationFloor > sourceFloor ? Direction::UP : Direction::DOWN;
+        return intake.tryPush(HallCall{sourceFloor, direction, destinationFloor});
+    }
+
+    // `passenger` identifies the trip to the TripObserver; -1 leaves it untracked
+    void addDestinationCall(int sourceFloor, int destinationFloor, int passenger = -1) {
+        ELEVATOR_METRIC_TIMER(timer, metrics.dispatchLatency, 1);
+        ELEVATOR_METRIC(metrics.destinationCalls.fetch_add(1, memory_order_relaxed));
+        LOG_INFO("Request received from floor " << sourceFloor << " to floor " << destinationFloor);
+        if (eventLog) {
+            eventLog->append(makeLogRecord(getTime(), LogRecordKind::DESTINATION_CALL, 0, sourceFloor, 0, destinationFloor));
+        }
+        if (parkingStrategy) parkingStrategy->recordCall(sourceFloor, getTime());
+        Direction direction = destinationFloor > sourceFloor ? Direction::UP : Direction::DOWN;
+        int selected = selectForDestination(HallCall{sourceFloor, direction, destinationFloor});
+        if (selected >= 0) {
+            elevators[selected]->addDestinationCall(sourceFloor, destinationFloor, passenger);
+        }
+    }
+
+    // Assigns a burst of hall calls in one strategy pass
+    void addToQueueBatch(const HallCall* calls, size_t count) {
+        if (count == 0) return;
+        // Calls outside the building are dropped before anything records or tracks them
+        size_t valid = 0;
+        while (valid < count && StopSet::inRange(calls[valid].floor)) valid++;
+        if (valid < count) {
+            vector<HallCall> accepted(calls, calls + valid);
+            for (size_t c = valid; c < count; c++) {
+                if (StopSet::inRange(calls[c].floor)) accepted.push_back(calls[c]);
+                else LOG_WARN("Ignoring request for invalid floor " << calls[c].floor);
+            }
+            addToQueueBatch(accepted.data(), accepted.size());
+            return;
+        }
+        ELEVATOR_METRIC_TIMER(timer, metrics.dispatchLatency, count);
+        ELEVATOR_METRIC(metrics.hallCalls.fetch_add(count, memory_order_relaxed));
+        LOG_INFO("Batch of " << count << " requests received");
+        if (eventLog) {
+            for (size_t c = 0; c < count; c++) {
+                eventLog->append(makeLogRecord(getTime(), LogRecordKind::HALL_CALL, 0, calls[c].floor,
+                                               static_cast<int>(calls[c].direction)));
+            }
+        }
+        if (parkingStrategy) {
+            for (size_t c = 0; c < count; c++) parkingStrategy->recordCall(calls[c].floor, getTime());
+        }
+        vector<int> selected(count);
+        selectBatch(calls, count, selected.data());
+        for (size_t c = 0; c < count; c++) {
+            if (selected[c] >= 0) {
+                elevators[selected[c]]->addToQueue(calls[c].floor);
+                if (redispatchInterval > 0) trackAssignment(calls[c].floor, calls[c].direction, selected[c]);
+            }
+        }
+    }
+
+    void addToQueueBatch(const vector<HallCall>& calls) {
+        addToQueueBatch(calls.data(), calls.size());
+    }
+
+    // Assigns a burst of destination calls in one strategy pass. `passengers`, if
+    // given, holds one TripObserver id per call.
+    void addDestinationCallBatch(const HallCall* calls, size_t count, const int* passengers = nullptr) {
+        if (count == 0) return;
+        ELEVATOR_METRIC_TIMER(timer, metrics.dispatchLatency, count);
+        ELEVATOR_METRIC(metrics.destinationCalls.fetch_add(count, memory_order_relaxed));
+        LOG_INFO("Batch of " << count << " destination requests received");
+        for (size_t c = 0; c < count; c++) {
+            if (eventLog) {
+                eventLog->append(makeLogRecord(getTime(), LogRecordKind::DESTINATION_CALL, 0, calls[c].floor, 0,
+                                               calls[c].destinationFloor));
+            }
+            if (parkingStrategy) parkingStrategy->recordCall(calls[c].floor, getTime());
+        }
+        vector<int> selected(count);
+        selectBatch(calls, count, selected.data());
+        for (size_t c = 0; c < count; c++) {
+            if (selected[c] >= 0) {
+                elevators[selected[c]]->addDestinationCall(calls[c].floor, calls[c].destinationFloor,
+                                                           passengers ? passengers[c] : -1);
+            }
+        }
+    }
+
+    // Faults or maintenance: the cars stop where they are, their pending events are
+    // dropped, and every call they still owed is re-routed to the rest of the fleet in
+    // one strategy pass, so service recovers within the same dispatch cycle. Riders are
+    // let out at the floor their car stopped at and ride on from there. Only on the
+    // simulation thread, between steps or at a runParallel boundary. Returns the
+    // number of calls re-routed.
+    size_t takeOutOfService(const ElevatorHandle* cars, size_t count);
+    size_t takeOutOfService(ElevatorHandle car) { return takeOutOfService(&car, 1); }
+    void returnToService(ElevatorHandle car);
+
+    size_t getOutOfServiceCount() const { return outOfService; }
+    unsigned long long getMigratedCallCount() const { return migrated; }
+
+    // Schedules an event relative to the current simulated time
+    void schedule(SimTime delay, EventType type, Elevator* elevator, int floor = 0) {
+        EventQueue& queue = queueFor(elevator);
+        queue.schedule(queue.getTime() + delay, type, elevator, floor);
+    }
+
+    // Queues a hall call to be dispatched at an absolute simulated time
+    void scheduleHallCall(SimTime at, int floor, Direction direction) {
+        events.schedule(at, EventType::HALL_CALL, nullptr, floor, direction);
+    }
+
+    // Processes the next event; returns false once the simulation has drained
+    // Observers are notified each time the clock is about to move on
+    bool step() {
+        drainIntake();
+        if (events.empty() || events.nextTime() > events.getTime()) {
+            flushNotifications();
+        }
+        if (events.empty()) return false;
+        dispatch(events.pop());
+        return true;
+    }
+
+    void run() {
+        while (step()) {}
+    }
+
+    // Processes every event up to `until` and leaves the clock there, so calls added
+    // next are stamped at `until` rather than at the last event
+    void runUntil(SimTime until) {
+        while (true) {
+            drainIntake();
+            if (events.empty() || events.nextTime() > until) break;
+            step();
+        }
+        flushNotifications();
+        if (until != LLONG_MAX) events.advanceTo(until);
+    }
+
+    // Warm start: a flat image of every car, its passengers, the pending events, the
+    // strategy's parameters and the re-dispatch interval and tracked hall calls. Only
+    // valid between steps, never during runParallel.
+    // Calls still in the intake are dispatched first so none are lost.
+    void writeSnapshot(vector<char>& image);
+    // Rebuilds that state in a manager that has no cars yet; false on a malformed or
+    // incompatible image. Observers, panels and the parking strategy are not part of it.
+    bool restoreSnapshot(const char* image, size_t size);
+    bool saveSnapshot(const string& path);
+    bool loadSnapshot(const string& path);  // Restores straight from a mapped file
+
+    // Runs the simulation on a pool of worker threads, see the definition for details
+    void runParallel(size_t workerCount, SimTime until = LLONG_MAX,
+                     SimTime epoch = FLOOR_TRAVEL_TIME, size_t shardSize = 1);
+
+    SimTime getTime() const {
+        const EventQueue* shard = runningShard();
+        return shard ? shard->getTime() : events.getTime();
+    }
+
+    // Broadcasts to every registered observer immediately
+    void notifyObservers(int floor, StateType state) {
+        for (auto observer : observers) {
+            observer->update(floor, state);
+        }
+    }
+
+    // Observer receives every change of the car at this fleet index
+    void subscribeToCar(ElevatorObserver* observer, int fleetIndex) {
+        if (fleetIndex < 0 || static_cast<size_t>(fleetIndex) >= carSubscribers.size()) return;
+        carSubscribers[static_cast<size_t>(fleetIndex)].push_back(subscriberId(observer));
+    }
+
+    // Observer receives changes of any car while it is at this floor
+    void subscribeToFloor(ElevatorObserver* observer, int floor) {
+        if (floor < 0 || floor >= MAX_FLOORS) return;
+        floorSubscribers[static_cast<size_t>(floor)].push_back(subscriberId(observer));
+    }
+
+    void unsubscribe(ElevatorObserver* observer) {
+        auto it = subscriberIds.find(observer);
+        if (it == subscriberIds.end()) return;
+        subscribers[static_cast<size_t>(it->second)] = nullptr;
+        subscriberIds.erase(it);
+    }
+
+    // Delivers the latest state of each car that changed since the last flush, at
+    // most once per subscriber, so cost follows the number of interested observers
+    void flushNotifications();
+
+    // Registers a caller-owned panel; it must outlive the manager
+    void addPanel(OuterPanel* panel);
+    void addInnerPanel(Elevator& elevator);
+
+    // Registers a caller-owned car; it must outlive the manager
+    void addElevator(Elevator* elevator) {
+        elevators.push_back(elevator);
+        fleet.resize(elevators.size());
+        carSubscribers.resize(elevators.size());
+        dirtyCars.resize(elevators.size());
+        redispatchDirty.resize(elevators.size());
+        if (outOfService > 0) rebuildServiceView();
+        elevator->setFleetIndex(static_cast<int>(elevators.size() - 1));
+    }
+
+    // Copies one car's dispatch-relevant fields into its FleetView slot
+    void updateFleetSlot(const Elevator& elevator) {
+        size_t i = static_cast<size_t>(elevator.getFleetIndex());
+        fleet.currentFloor[i] = elevator.getCurrentFloor();
+        fleet.state[i] = static_cast<int>(elevator.getStateType());
+        fleet.direction[i] = elevator.getSweepDirection() == Direction::UP ? 1 : -1;
+        fleet.pendingStops[i] = static_cast<int>(elevator.getPendingStopCount());
+        fleet.full[i] = elevator.isFull() ? 1 : 0;
+        const RouteSummary& route = elevator.getRouteSummary();
+        fleet.lastStop[i] = route.lastStop;
+        fleet.remainingFloors[i] = route.remainingFloors;
+        fleet.freeAt[i] = route.freeAt;
+        if (outOfService > 0 && serviceSlot[i] >= 0) serviceFleet.copySlot(static_cast<size_t>(serviceSlot[i]), fleet, i);
+        dirtyCars[i] = 1;
+        redispatchDirty[i] = 1;
+        notificationsPending.store(true, memory_order_relaxed);
+    }
+
+    const FleetView& getFleetView() const { return fleet; }
+
+#if ELEVATOR_METRICS
+    ElevatorMetrics& getMetrics() { return metrics; }
+
+    // Point-in-time copy of the counters, histograms and per-car queue depths. Safe
+    // between steps; during runParallel the histograms may be mid-update.
+    MetricsSnapshot getMetricsSnapshot() const {
+        MetricsSnapshot snapshot;
+        snapshot.dispatchLatency = metrics.dispatchLatency.snapshot();
+        snapshot.callServeTime = metrics.callServeTime.snapshot();
+        snapshot.passengerWait = metrics.passengerWait.snapshot();
+        snapshot.queueDepth = metrics.queueDepth.snapshot();
+        for (size_t state = 0; state < snapshot.stateTransitions.size(); state++) {
+            snapshot.stateTransitions[state] = metrics.stateTransitions[state].load(memory_order_relaxed);
+        }
+        snapshot.hallCalls = metrics.hallCalls.load(memory_order_relaxed);
+        snapshot.destinationCalls = metrics.destinationCalls.load(memory_order_relaxed);
+        snapshot.doorOpenings = metrics.doorOpenings.load(memory_order_relaxed);
+        for (size_t i = 0; i < elevators.size(); i++) {
+            snapshot.queueDepthByCar.push_back(MetricsSnapshot::CarGauge{elevators[i]->getId(), fleet.pendingStops[i]});
+        }
+        return snapshot;
+    }
+#endif
+};
+
+// Outer Panel Class
+class OuterPanel : public ElevatorObserver {
+private:
+    int floor;
+    ElevatorManager* manager;
+    int currentDisplayFloor;
+    Direction currentDirection;
+
+public:
+    OuterPanel(int floorNum, ElevatorManager* mgr) 
+        : floor(floorNum), manager(mgr), currentDisplayFloor(1) {
+        LOG_INFO("Panel created at floor " << floorNum);
+    }
+
+    // Safe to call from any thread; the manager dispatches on its next step
+    bool requestElevator(Direction direction) {
+        LOG_INFO("Panel at floor " << floor << " requesting elevator");
+        if (!manager->submitHallCall(floor, direction)) {
+            LOG_WARN("Panel at floor " << floor << " dropped request: dispatcher is saturated");
+            return false;
+        }
+        return true;
+    }
+
+    // Destination-dispatch keypad: the passenger enters the floor they are going to
+    bool requestDestination(int destinationFloor) {
+        LOG_INFO("Panel at floor " << floor << " requesting floor " << destinationFloor);
+        if (!manager->submitDestinationCall(floor, destinationFloor)) {
+            LOG_WARN("Panel at floor " << floor << " dropped request: dispatcher is saturated");
+            return false;
+        }
+        return true;
+    }
+
+    int getFloor() const { return floor; }
+
+    void update(int floor, StateType state) override {
+        currentDisplayFloor = floor;
+        LOG_DEBUG("Panel at floor " << this->floor << " updated: Elevator at floor "
+                  << floor << " (" << getStateName(state) << ")");
+    }
+};
+
+// Inner Panel Class
+// Buttons inside one car. Each press is a car call: a stop committed to that car and
+// merged into its LOOK sweep alongside the hall calls assigned to it.
+class InnerPanel : public ElevatorObserver {
+private:
+    Elevator* elevator;
+    ElevatorManager* manager;
+    int currentDisplayFloor;
+
+public:
+    InnerPanel(Elevator* car, ElevatorManager* mgr)
+        : elevator(car), manager(mgr), currentDisplayFloor(car->getCurrentFloor()) {}
+
+    // Safe to call from any thread; the manager applies it on its next step
+    bool requestFloor(int floor) {
+        LOG_INFO("Panel in elevator " << elevator->getId() << " requesting floor " << floor);
+        if (!manager->submitCarCall(elevator->getFleetIndex(), floor)) {
+            LOG_WARN("Panel in elevator " << elevator->getId() << " dropped request: dispatcher is saturated");
+            return false;
+        }
+        return true;
+    }
+
+    int getDisplayFloor() const { return currentDisplayFloor; }
+
+    void update(int floor, StateType state) override {
+        currentDisplayFloor = floor;
+        LOG_TRACE("Panel in elevator " << elevator->getId() << " updated: at floor " << floor
+                  << " (" << getStateName(state) << ")");
+    }
+};
+
+// Group control for buildings split into banks (low-rise, mid-rise, high-rise, sky
+// lobby). Each bank is an independent ElevatorManager with its own cars, strategy and
+// clock; the router forwards a call only to the banks whose served floors include it,
+// so dispatch scans one bank's cars and banks can be simulated on separate cores.
+class BuildingRouter {
+private:
+    struct Bank {
+        string name;
+        StopSet servedFloors;
+        unique_ptr<ElevatorManager> manager;
+    };
+
+    vector<unique_ptr<Bank>> banks;
+    vector<vector<int>> banksByFloor;  // Bank indices serving each floor
+    atomic<size_t> nextSharedBank;     // Spreads submissions at floors served by several banks
+
+    // Least pending stops per car among the candidate banks
+    int leastLoadedBank(const vector<int>& candidates) const {
+        int best = -1;
+        double bestLoad = 0.0;
+        for (int index : candidates) {
+            const FleetView& fleet = banks[static_cast<size_t>(index)]->manager->getFleetView();
+            if (fleet.size() == 0) continue;
+            long long stops = 0;
+            for (int pending : fleet.pendingStops) stops += pending;
+            double load = static_cast<double>(stops) / static_cast<double>(fleet.size());
+            if (best < 0 || load < bestLoad) {
+                best = index;
+                bestLoad = load;
+            }
+        }
+        return best;
+    }
+
+    vector<int> banksServing(int sourceFloor, int destinationFloor) const {
+        vector<int> candidates;
+        if (!StopSet::inRange(sourceFloor)) return candidates;
+        for (int index : banksByFloor[static_cast<size_t>(sourceFloor)]) {
+            if (banks[static_cast<size_t>(index)]->servedFloors.contains(destinationFloor)) {
+                candidates.push_back(index);
+            }
+        }
+        return candidates;
+    }
+
+    static const vector<int>& noBanks() {
+        static const vector<int> empty;
+        return empty;
+    }
+
+public:
+    BuildingRouter() : banksByFloor(MAX_FLOORS), nextSharedBank(0) {}
+
+    // Adds a bank serving [lowestFloor, highestFloor] plus extra floors such as the lobby.
+    // Cars, panels and the strategy are configured on the returned manager.
+    ElevatorManager& addBank(const string& name, int lowestFloor, int highestFloor,
+                             const vector<int>& extraFloors = vector<int>()) {
+        unique_ptr<Bank> bank(new Bank{name, StopSet(), unique_ptr<ElevatorManager>(new ElevatorManager())});
+        for (int floor = lowestFloor; floor <= highestFloor; floor++) bank->servedFloors.add(floor);
+        for (int floor : extraFloors) bank->servedFloors.add(floor);
+        int index = static_cast<int>(banks.size());
+        for (int floor = 0; floor < MAX_FLOORS; floor++) {
+            if (bank->servedFloors.contains(floor)) banksByFloor[static_cast<size_t>(floor)].push_back(index);
+        }
+        LOG_INFO("Bank " << name << " serves floors " << lowestFloor << "-" << highestFloor);
+        banks.push_back(std::move(bank));
+        return *banks.back()->manager;
+    }
+
+    size_t getBankCount() const { return banks.size(); }
+    ElevatorManager& getBank(size_t index) { return *banks[index]->manager; }
+    const string& getBankName(size_t index) const { return banks[index]->name; }
+
+    const vector<int>& banksServing(int floor) const {
+        return StopSet::inRange(floor) ? banksByFloor[static_cast<size_t>(floor)] : noBanks();
+    }
+
+    // Simulation-thread entry points; a shared floor goes to its least-loaded bank
+    bool addToQueue(int floor, Direction direction) {
+        int bank = leastLoadedBank(banksServing(floor));
+        if (bank < 0) {
+            LOG_WARN("No bank serves floor " << floor);
+            return false;
+        }
+        banks[static_cast<size_t>(bank)]->manager->addToQueue(floor, direction);
+        return true;
+    }
+
+    bool addDestinationCall(int sourceFloor, int destinationFloor, int passenger = -1) {
+        int bank = leastLoadedBank(banksServing(sourceFloor, destinationFloor));
+        if (bank < 0) {
+            LOG_WARN("No bank serves a trip from floor " << sourceFloor << " to floor " << destinationFloor);
+            return false;
+        }
+        banks[static_cast<size_t>(bank)]->manager->addDestinationCall(sourceFloor, destinationFloor, passenger);
+        return true;
+    }
+
+    // Thread-safe entry points. They only read the static floor map, so a shared floor
+    // is spread round-robin instead of by load.
+    bool submitHallCall(int floor, Direction direction) {
+        const vector<int>& candidates = banksServing(floor);
+        if (candidates.empty()) return false;
+        size_t pick = candidates.size() == 1 ? 0 : nextSharedBank.fetch_add(1) % candidates.size();
+        return banks[static_cast<size_t>(candidates[pick])]->manager->submitHallCall(floor, direction);
+    }
+
+    bool submitDestinationCall(int sourceFloor, int destinationFloor) {
+        vector<int> candidates = banksServing(sourceFloor, destinationFloor);
+        if (candidates.empty()) return false;
+        size_t pick = candidates.size() == 1 ? 0 : nextSharedBank.fetch_add(1) % candidates.size();
+        return banks[static_cast<size_t>(candidates[pick])]->manager->submitDestinationCall(sourceFloor, destinationFloor);
+    }
+
+    void run() {
+        for (auto& bank : banks) bank->manager->run();
+    }
+
+    void runUntil(SimTime until) {
+        for (auto& bank : banks) bank->manager->runUntil(until);
+    }
+
+    // Banks share no state, so each one advances on its own thread
+    void runParallel(SimTime until = LLONG_MAX) {
+        vector<thread> threads;
+        for (auto& bank : banks) {
+            ElevatorManager* manager = bank->manager.get();
+            threads.emplace_back([manager, until] { manager->runUntil(until); });
+        }
+        for (thread& worker : threads) worker.join();
+    }
+};
+
+// Compile-time building configuration for fixed installations. Floors, car count and
+// the dispatch policy are template parameters: stop sets and fleet arrays live inline,
+// fleet scans have a constant trip count, and no virtual call sits on the dispatch
+// or movement path. Cars follow the same LOOK and timing rules as Elevator.
+
+// Fleet arrays for a fixed number of cars, laid out like FleetView
+template <int Cars>
+struct StaticFleet {
+    array<int, Cars> currentFloor;
+    array<int, Cars> state;            // StateType
+    array<int, Cars> direction;        // Sweep direction: +1 up, -1 down
+    array<int, Cars> pendingStops;
+
+    static constexpr int size() { return Cars; }
+};
+
+// Policies plug into ElevatorSystem through a static select(), so the call inlines
+struct NearestCarPolicy {
+    // Same ranking as NearestElevatorStrategy
+    template <int Cars>
+    static int select(int floor, Direction direction, const StaticFleet<Cars>& fleet) {
+        const int idle = static_cast<int>(StateType::IDLE);
+        const int wanted = static_cast<int>(direction == Direction::UP ? StateType::MOVING_UP
+                                                                        : StateType::MOVING_DOWN);
+        const int sign = direction == Direction::UP ? 1 : -1;
+        int nearest = 0;
+        int shortestDistance = abs(floor - fleet.currentFloor[0]);
+        // Branch-free body; car 0 is the fallback, so it starts as the best
+        for (int i = 1; i < Cars; i++) {
+            int offset = floor - fleet.currentFloor[static_cast<size_t>(i)];
+            int carState = fleet.state[static_cast<size_t>(i)];
+            bool eligible = carState == idle || (carState == wanted && offset * sign > 0);
+            int cost = eligible ? abs(offset) : INT_MAX;
+            bool better = cost < shortestDistance;
+            shortestDistance = better ? cost : shortestDistance;
+            nearest = better ? i : nearest;
+        }
+        return nearest;
+    }
+};
+
+template <int Floors, int Cars, typename Strategy = NearestCarPolicy>
+class ElevatorSystem {
+    static_assert(Floors > 1, "a building needs at least two floors");
+    static_assert(Cars > 0, "a building needs at least one car");
+
+private:
+    // Each car has at most one pending event, so a slot per car replaces the heap
+    enum class CarEvent : uint8_t { NONE, FLOOR_ARRIVAL, DOOR_OPEN, DOOR_CLOSE };
+
+    StaticFleet<Cars> fleet;
+    array<FloorBitset<Floors>, Cars> stops;
+    array<SimTime, Cars> nextEventAt;
+    array<CarEvent, Cars> nextEvent;
+    array<bool, Cars> doorsOpen;
+    array<long long, Cars> floorsTravelled;
+    SimTime now;
+
+    void scheduleEvent(int car, SimTime delay, CarEvent event) {
+        nextEventAt[static_cast<size_t>(car)] = now + delay;
+        nextEvent[static_cast<size_t>(car)] = event;
+    }
+
+    void setState(int car, StateType state) {
+        fleet.state[static_cast<size_t>(car)] = static_cast<int>(state);
+    }
+
+    bool isBusy(int car) const {
+        return doorsOpen[static_cast<size_t>(car)] ||
+               fleet.state[static_cast<size_t>(car)] != static_cast<int>(StateType::IDLE);
+    }
+
+    int nextStop(int car) const {
+        const FloorBitset<Floors>& pending = stops[static_cast<size_t>(car)];
+        int floor = fleet.currentFloor[static_cast<size_t>(car)];
+        if (pending.contains(floor)) return floor;
+        int above = pending.nextAbove(floor);
+        int below = pending.nextBelow(floor);
+        if (fleet.direction[static_cast<size_t>(car)] > 0) {
+            return above != NO_FLOOR ? above : below;
+        }
+        return below != NO_FLOOR ? below : above;
+    }
+
+    void openDoors(int car) {
+        size_t slot = static_cast<size_t>(car);
+        stops[slot].remove(fleet.currentFloor[slot]);
+        fleet.pendingStops[slot] = stops[slot].size();
+        doorsOpen[slot] = true;
+        setState(car, StateType::IDLE);
+        scheduleEvent(car, 0, CarEvent::DOOR_OPEN);
+    }
+
+    void processQueue(int car) {
+        size_t slot = static_cast<size_t>(car);
+        if (stops[slot].empty()) return;
+        int target = nextStop(car);
+        int floor = fleet.currentFloor[slot];
+        if (target == floor) {
+            openDoors(car);
+            return;
+        }
+        fleet.direction[slot] = target > floor ? 1 : -1;
+        setState(car, target > floor ? StateType::MOVING_UP : StateType::MOVING_DOWN);
+        scheduleEvent(car, FLOOR_TRAVEL_TIME, CarEvent::FLOOR_ARRIVAL);
+    }
+
+    void handle(int car, CarEvent event) {
+        size_t slot = static_cast<size_t>(car);
+        nextEvent[slot] = CarEvent::NONE;
+        nextEventAt[slot] = LLONG_MAX;
+        switch (event) {
+            case CarEvent::FLOOR_ARRIVAL:
+                fleet.currentFloor[slot] += fleet.direction[slot];
+                floorsTravelled[slot]++;
+                if (stops[slot].contains(fleet.currentFloor[slot])) {
+                    openDoors(car);
+                } else {
+                    scheduleEvent(car, FLOOR_TRAVEL_TIME, CarEvent::FLOOR_ARRIVAL);
+                }
+                break;
+            case CarEvent::DOOR_OPEN:
+                scheduleEvent(car, DOOR_DWELL_TIME, CarEvent::DOOR_CLOSE);
+                break;
+            case CarEvent::DOOR_CLOSE:
+                doorsOpen[slot] = false;
+                processQueue(car);
+                break;
+            case CarEvent::NONE:
+                break;
+        }
+    }
+
+    // Earliest pending car event, lowest car first on ties; -1 if none
+    int nextCar() const {
+        int next = -1;
+        SimTime earliest = LLONG_MAX;
+        for (int i = 0; i < Cars; i++) {
+            if (nextEventAt[static_cast<size_t>(i)] < earliest) {
+                earliest = nextEventAt[static_cast<size_t>(i)];
+                next = i;
+            }
+        }
+        return next;
+    }
+
+public:
+    ElevatorSystem() : now(0) {
+        for (size_t i = 0; i < static_cast<size_t>(Cars); i++) {
+            fleet.currentFloor[i] = 1;
+            fleet.state[i] = static_cast<int>(StateType::IDLE);
+            fleet.direction[i] = 1;
+            fleet.pendingStops[i] = 0;
+            nextEventAt[i] = LLONG_MAX;
+            nextEvent[i] = CarEvent::NONE;
+            doorsOpen[i] = false;
+            floorsTravelled[i] = 0;
+        }
+    }
+
+    // Hall call: the policy picks the car; returns it, or -1 if the call was rejected
+    int addToQueue(int floor, Direction direction) {
+        if (!FloorBitset<Floors>::inRange(floor)) return -1;
+        int car = Strategy::select(floor, direction, fleet);
+        if (car >= 0) addStop(car, floor);
+        return car;
+    }
+
+    // Car call, or a stop the caller has already assigned
+    void addStop(int car, int floor) {
+        size_t slot = static_cast<size_t>(car);
+        if (!FloorBitset<Floors>::inRange(floor)) return;
+        if (doorsOpen[slot] && floor == fleet.currentFloor[slot]) return;
+        if (!stops[slot].add(floor)) return;
+        fleet.pendingStops[slot] = stops[slot].size();
+        if (!isBusy(car)) processQueue(car);
+    }
+
+    // Processes the next car event; returns false once every car is idle
+    bool step() {
+        int car = nextCar();
+        if (car < 0) return false;
+        now = nextEventAt[static_cast<size_t>(car)];
+        handle(car, nextEvent[static_cast<size_t>(car)]);
+        return true;
+    }
+
+    void run() {
+        while (step()) {}
+    }
+
+    // Like ElevatorManager::runUntil, leaves the clock at `until`
+    void runUntil(SimTime until) {
+        for (int car = nextCar(); car >= 0 && nextEventAt[static_cast<size_t>(car)] <= until; car = nextCar()) {
+            step();
+        }
+        if (until != LLONG_MAX && until > now) now = until;
+    }
+
+    SimTime getTime() const { return now; }
+    const StaticFleet<Cars>& getFleet() const { return fleet; }
+    int getCurrentFloor(int car) const { return fleet.currentFloor[static_cast<size_t>(car)]; }
+    StateType getStateType(int car) const { return static_cast<StateType>(fleet.state[static_cast<size_t>(car)]); }
+    long long getFloorsTravelled(int car) const { return floorsTravelled[static_cast<size_t>(car)]; }
+    bool areDoorsOpen(int car) const { return doorsOpen[static_cast<size_t>(car)]; }
+};
+
+// Network Intake
+// Wire format, little-endian whatever the host's byte order. A frame is a 4-byte header
+// {uint16 count, uint16 reserved} followed by `count` 8-byte calls; a call whose
+// destination is NO_FLOOR is a plain hall call, otherwise it is a destination call
+// from `floor`.
+inline uint16_t loadLittleEndian16(const char* bytes) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(bytes[0]) | static_cast<uint8_t>(bytes[1]) << 8);
+}
+
+inline void storeLittleEndian16(char* bytes, uint16_t value) {
+    bytes[0] = static_cast<char>(value & 0xff);
+    bytes[1] = static_cast<char>(value >> 8);
+}
+
+struct HallCallFrameHeader {
+    static const size_t SIZE = 4;
+    uint16_t count;
+    uint16_t reserved;
+
+    static HallCallFrameHeader read(const char* bytes) {
+        return HallCallFrameHeader{loadLittleEndian16(bytes), loadLittleEndian16(bytes + 2)};
+    }
+
+    void write(char* bytes) const {
+        storeLittleEndian16(bytes, count);
+        storeLittleEndian16(bytes + 2, reserved);
+    }
+};
+
+struct HallCallWire {
+    static const size_t SIZE = 8;
+    int16_t floor;
+    int16_t destination;
+    uint8_t direction;     // Direction
+
+    static HallCallWire read(const char* bytes) {
+        return HallCallWire{static_cast<int16_t>(loadLittleEndian16(bytes)),
+                            static_cast<int16_t>(loadLittleEndian16(bytes + 2)), static_cast<uint8_t>(bytes[4])};
+    }
+
+    void write(char* bytes) const {
+        storeLittleEndian16(bytes, static_cast<uint16_t>(floor));
+        storeLittleEndian16(bytes + 2, static_cast<uint16_t>(destination));
+        bytes[4] = static_cast<char>(direction);
+        memset(bytes + 5, 0, 3);
+    }
+
+    // Floors inside the building and a known direction; anything else ends the connection
+    bool isValid() const {
+        return direction <= static_cast<uint8_t>(Direction::DOWN) && StopSet::inRange(floor) &&
+               (destination == NO_FLOOR || StopSet::inRange(destination));
+    }
+};
+
+const size_t MAX_CALLS_PER_FRAME = 1024;
+
+// Accepts hall-call frames over TCP on a background thread and decodes each call
+// straight from the receive buffer into the manager's intake queue. When the intake
+// is full the connection stops being read from mid-frame and resumes at the first
+// unaccepted call once the simulation drains, so the sender is held back by TCP flow
+// control rather than having calls dropped. Uses non-blocking sockets and poll(), so
+// the same loop runs on Linux and macOS.
+// Readiness of the server's sockets: epoll on Linux, poll elsewhere. Both are level
+// triggered, so a socket is reported again until it has been read dry. A socket
+// that is not watched for input still reports hang-ups and errors.
+class SocketPoller {
+#ifdef ELEVATOR_HAS_EPOLL
+private:
+    int epollFd;
+    vector<epoll_event> events;
+
+    void control(int operation, int fd, uint32_t interest) {
+        epoll_event event{};
+        event.events = interest;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, operation, fd, &event);
+    }
+
+public:
+    SocketPoller() : epollFd(epoll_create1(EPOLL_CLOEXEC)), events(64) {}
+    ~SocketPoller() {
+        if (epollFd >= 0) ::close(epollFd);
+    }
+
+    bool isValid() const { return epollFd >= 0; }
+    void add(int fd) { control(EPOLL_CTL_ADD, fd, EPOLLIN); }
+    void watchInput(int fd, bool watched) { control(EPOLL_CTL_MOD, fd, watched ? static_cast<uint32_t>(EPOLLIN) : 0u); }
+    void remove(int fd) { control(EPOLL_CTL_DEL, fd, 0); }
+
+    // Replaces `ready` with the sockets that have input, a hang-up or an error
+    void wait(int timeoutMs, vector<int>& ready) {
+        ready.clear();
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeoutMs);
+        for (int i = 0; i < count; i++) ready.push_back(events[static_cast<size_t>(i)].data.fd);
+    }
+#else
+private:
+    vector<pollfd> polled;
+
+public:
+    SocketPoller() {}
+
+    bool isValid() const { return true; }
+    void add(int fd) { polled.push_back(pollfd{fd, POLLIN, 0}); }
+    void watchInput(int fd, bool watched) {
+        for (pollfd& entry : polled) {
+            if (entry.fd == fd) entry.events = watched ? POLLIN : 0;
+        }
+    }
+    void remove(int fd) {
+        for (size_t i = 0; i < polled.size(); i++) {
+            if (polled[i].fd != fd) continue;
+            polled[i] = polled.back();
+            polled.pop_back();
+            return;
+        }
+    }
+
+    void wait(int timeoutMs, vector<int>& ready) {
+        ready.clear();
+        if (poll(polled.data(), static_cast<nfds_t>(polled.size()), timeoutMs) <= 0) return;
+        for (const pollfd& entry : polled) {
+            if (entry.revents & (POLLIN | POLLHUP | POLLERR)) ready.push_back(entry.fd);
+        }
+    }
+#endif
+    SocketPoller(const SocketPoller&) = delete;
+    SocketPoller& operator=(const SocketPoller&) = delete;
+};
+
+class HallCallServer {
+private:
+    struct Connection {
+        int fd;
+        vector<char> buffer;    // Fixed size; recv writes straight into its free tail
+        size_t filled;          // Bytes of buffer received
+        size_t consumed;        // Bytes of buffer already decoded
+        size_t pendingCalls;    // Calls of the current frame not yet decoded
+        bool stalled;           // Intake was full; waiting for it to drain
+        bool ready;             // Reported by the poller this round
+    };
+
+    static const size_t RECEIVE_BUFFER_BYTES = 64 * 1024;
+    static const int POLL_INTERVAL_MS = 1;
+
+    ElevatorManager& manager;
+    int listenFd;
+    uint16_t port;
+    vector<Connection> connections;
+    unordered_map<int, size_t> connectionAt;  // Index in connections by fd
+    SocketPoller poller;
+    thread loop;
+    atomic<bool> stopping;
+    atomic<uint64_t> callsAccepted;
+    atomic<uint64_t> framesDecoded;
+    atomic<uint64_t> stalls;
+    atomic<uint64_t> protocolErrors;
+
+    static bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    // Moves the undecoded tail to the front of the buffer
+    static void compact(Connection& connection) {
+        size_t tail = connection.filled - connection.consumed;
+        memmove(connection.buffer.data(), connection.buffer.data() + connection.consumed, tail);
+        connection.filled = tail;
+        connection.consumed = 0;
+    }
+
+    // Decodes as far as the buffered bytes and the intake allow; false on a bad frame
+    bool decode(Connection& connection) {
+        connection.stalled = false;
+        while (true) {
+            size_t available = connection.filled - connection.consumed;
+            const char* next = connection.buffer.data() + connection.consumed;
+            if (connection.pendingCalls == 0) {
+                if (available < HallCallFrameHeader::SIZE) break;
+                HallCallFrameHeader header = HallCallFrameHeader::read(next);
+                if (header.count > MAX_CALLS_PER_FRAME) return false;
+                connection.consumed += HallCallFrameHeader::SIZE;
+                connection.pendingCalls = header.count;
+                framesDecoded.fetch_add(1, memory_order_relaxed);
+                continue;
+            }
+            if (available < HallCallWire::SIZE) break;
+            HallCallWire call = HallCallWire::read(next);
+            if (!call.isValid()) return false;
+            bool accepted = call.destination == NO_FLOOR
+                ? manager.submitHallCall(call.floor, static_cast<Direction>(call.direction))
+                : manager.submitDestinationCall(call.floor, call.destination);
+            if (!accepted) {
+                connection.stalled = true;
+                stalls.fetch_add(1, memory_order_relaxed);
+                break;
+            }
+            connection.consumed += HallCallWire::SIZE;
+            connection.pendingCalls--;
+            callsAccepted.fetch_add(1, memory_order_relaxed);
+        }
+        // Slide the undecoded tail to the front once most of the buffer is spent
+        if (connection.consumed > connection.filled / 2) compact(connection);
+        return true;
+    }
+
+    // Reads until the socket would block or RECEIVE_BUFFER_BYTES are waiting to be
+    // decoded; false once closed. The buffer holds twice that, so there is always room.
+    bool receive(Connection& connection) {
+        while (connection.filled - connection.consumed < RECEIVE_BUFFER_BYTES) {
+            if (connection.filled == connection.buffer.size()) compact(connection);
+            ssize_t received = recv(connection.fd, connection.buffer.data() + connection.filled,
+                                    connection.buffer.size() - connection.filled, 0);
+            if (received > 0) {
+                connection.filled += static_cast<size_t>(received);
+                continue;
+            }
+            if (received == 0) return false;
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        return true;
+    }
+
+    void acceptPending() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) return;
+            if (!setNonBlocking(fd)) {
+                ::close(fd);
+                continue;
+            }
+            connectionAt[fd] = connections.size();
+            connections.push_back(Connection{fd, vector<char>(2 * RECEIVE_BUFFER_BYTES), 0, 0, 0, false, false});
+            poller.add(fd);
+        }
+    }
+
+    void serve() {
+        vector<int> ready;
+        while (!stopping.load()) {
+            poller.wait(POLL_INTERVAL_MS, ready);
+            for (int fd : ready) {
+                if (fd == listenFd) {
+                    acceptPending();
+                    continue;
+                }
+                auto found = connectionAt.find(fd);
+                if (found != connectionAt.end()) connections[found->second].ready = true;
+            }
+            for (size_t i = 0; i < connections.size();) {
+                Connection& connection = connections[i];
+                bool wasStalled = connection.stalled;
+                bool open = true;
+                if (connection.stalled) {
+                    open = decode(connection);
+                } else if (connection.ready) {
+                    open = receive(connection);
+                    if (!decode(connection)) {
+                        protocolErrors.fetch_add(1, memory_order_relaxed);
+                        open = false;
+                    }
+                }
+                connection.ready = false;
+                // Stalled connections are not watched for input: the kernel buffer fills
+                // and the sender blocks until the intake has room again
+                if (connection.stalled != wasStalled) poller.watchInput(connection.fd, !connection.stalled);
+                if (open || connection.stalled) {
+                    i++;
+                    continue;
+                }
+                poller.remove(connection.fd);
+                ::close(connection.fd);
+                connectionAt.erase(connection.fd);
+                connections[i] = std::move(connections.back());
+                connections.pop_back();
+                if (i < connections.size()) connectionAt[connections[i].fd] = i;
+            }
+        }
+        for (const Connection& connection : connections) ::close(connection.fd);
+        connections.clear();
+        connectionAt.clear();
+    }
+
+public:
+    explicit HallCallServer(ElevatorManager& mgr)
+        : manager(mgr), listenFd(-1), port(0), stopping(false), callsAccepted(0), framesDecoded(0),
+          stalls(0), protocolErrors(0) {}
+
+    ~HallCallServer() {
+        stop();
+        if (listenFd >= 0) ::close(listenFd);
+    }
+
+    HallCallServer(const HallCallServer&) = delete;
+    HallCallServer& operator=(const HallCallServer&) = delete;
+
+    // Binds a non-blocking listener; port 0 picks a free port, see getPort
+    bool listen(uint16_t requestedPort, const string& address = "127.0.0.1") {
+        if (!poller.isValid()) return false;
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) return false;
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in bound{};
+        bound.sin_family = AF_INET;
+        bound.sin_port = htons(requestedPort);
+        if (inet_pton(AF_INET, address.c_str(), &bound.sin_addr) != 1 ||
+            bind(listenFd, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) != 0 ||
+            ::listen(listenFd, 16) != 0 || !setNonBlocking(listenFd)) {
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        socklen_t length = sizeof(bound);
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&bound), &length);
+        port = ntohs(bound.sin_port);
+        poller.add(listenFd);
+        LOG_INFO("Hall call intake listening on " << address << ":" << port);
+        return true;
+    }
+
+    void start() {
+        if (listenFd < 0 || loop.joinable()) return;
+        stopping.store(false);
+        loop = thread(&HallCallServer::serve, this);
+    }
+
+    void stop() {
+        stopping.store(true);
+        if (loop.joinable()) loop.join();
+    }
+
+    uint16_t getPort() const { return port; }
+    uint64_t getCallsAccepted() const { return callsAccepted.load(memory_order_relaxed); }
+    uint64_t getFramesDecoded() const { return framesDecoded.load(memory_order_relaxed); }
+    uint64_t getStalls() const { return stalls.load(memory_order_relaxed); }
+    uint64_t getProtocolErrors() const { return protocolErrors.load(memory_order_relaxed); }
+};
+
+// Elevator Implementation
+Elevator::Elevator(int id, ElevatorManager* mgr) 
+    : id(id), currentFloor(1), state(IdleState::instance()), stateType(StateType::IDLE),
+      sweepDirection(Direction::UP), manager(mgr), doorsOpen(false), floorsTravelled(0),
+      fleetIndex(-1), parkingFloor(NO_FLOOR), capacity(0), ratedLoadKg(0.0), loadKg(0.0), plannedDropoffs(), route{1, 0, 0} {
+    LOG_INFO("Elevator " << id << " created at floor " << currentFloor);
+}
+
+// O(1) in the number of stops: only the extremes of the stop bitset matter
+void Elevator::refreshRoute() {
+    route.lastStop = currentFloor;
+    route.remainingFloors = 0;
+    if (!pendingStops.empty()) {
+        int low = min(pendingStops.lowest(), currentFloor);
+        int high = max(pendingStops.highest(), currentFloor);
+        bool up = sweepDirection == Direction::UP ? high > currentFloor : low == currentFloor;
+        if (up) {
+            route.remainingFloors = (high - currentFloor) + (low < currentFloor ? high - low : 0);
+            route.lastStop = low < currentFloor ? low : high;
+        } else {
+            route.remainingFloors = (currentFloor - low) + (high > currentFloor ? high - low : 0);
+            route.lastStop = high > currentFloor ? high : low;
+        }
+    }
+    SimTime now = manager ? manager->getTime() : 0;
+    route.freeAt = now + route.remainingFloors * FLOOR_TRAVEL_TIME +
+                   static_cast<SimTime>(pendingStops.size()) * DOOR_DWELL_TIME +
+                   (doorsOpen ? DOOR_DWELL_TIME : 0);
+}
+
+void Elevator::logEvent(LogRecordKind kind, int floor, int value) const {
+    EventLogWriter* log = manager ? manager->getEventLog() : nullptr;
+    if (log) log->append(makeLogRecord(manager->getTime(), kind, id, floor, value));
+}
+
+void Elevator::syncFleetView() {
+    refreshRoute();
+    if (manager && fleetIndex >= 0) {
+        manager->updateFleetSlot(*this);
+    }
+}
+
+void Elevator::setState(StateType newType) {
+    state = getBuiltinState(newType);
+    stateType = newType;
+    customState.reset();
+    ELEVATOR_METRIC(if (manager) manager->getMetrics().countTransition(newType));
+    logEvent(LogRecordKind::STATE_CHANGE, currentFloor, static_cast<int>(newType));
+    syncFleetView();
+    LOG_DEBUG("Elevator " << id << " changed state to " << getStateName(newType));
+}
+
+void Elevator::setState(unique_ptr<State> newState) {
+    state = newState.get();
+    stateType = newState->getType();
+    customState = std::move(newState);
+    ELEVATOR_METRIC(if (manager) manager->getMetrics().countTransition(stateType));
+    logEvent(LogRecordKind::STATE_CHANGE, currentFloor, static_cast<int>(stateType));
+    syncFleetView();
+    LOG_DEBUG("Elevator " << id << " changed state to " << getStateName(stateType));
+}
+
+void Elevator::addToQueue(int floor) {
+    if (!StopSet::inRange(floor)) {
+        LOG_WARN("Elevator " << id << " ignoring request for invalid floor " << floor);
+        return;
+    }
+    if (!isInService()) {
+        LOG_WARN("Elevator " << id << " is out of service, ignoring request for floor " << floor);
+        return;
+    }
+    if (doorsOpen && floor == currentFloor) {
+        LOG_DEBUG("Elevator " << id << " is already open at floor " << floor);
+        return;
+    }
+    if (!pendingStops.add(floor)) {
+        LOG_DEBUG("Elevator " << id << " already has a stop at floor " << floor);
+        return;
+    }
+#if ELEVATOR_METRICS
+    if (manager) {
+        stopRequestedAt[static_cast<size_t>(floor)] = manager->getTime();
+        manager->getMetrics().queueDepth.record(pendingStops.size());
+    }
+#endif
+    logEvent(LogRecordKind::STOP_ADDED, floor);
+    syncFleetView();
+    LOG_INFO("Elevator " << id << " received request for floor " << floor);
+    if (!isBusy()) {
+        processQueue();
+    }
+}
+
+void Elevator::addCarCall(int floor) {
+    if (StopSet::inRange(floor) && isInService() && !(doorsOpen && floor == currentFloor)) {
+        carCalls.add(floor);
+        logEvent(LogRecordKind::CAR_CALL, floor);
+    }
+    addToQueue(floor);
+}
+
+void Elevator::addDestinationCall(int sourceFloor, int destinationFloor, int passenger) {
+    if (!StopSet::inRange(sourceFloor) || !StopSet::inRange(destinationFloor)) {
+        LOG_WARN("Elevator " << id << " ignoring trip from floor " << sourceFloor
+                 << " to invalid floor " << destinationFloor);
+        return;
+    }
+    assignPassenger(manager->acquirePassenger(passenger, sourceFloor, destinationFloor));
+}
+
+void Elevator::assignPassenger(Passenger* passenger) {
+    if (!isInService()) {
+        if (!manager->submitPassenger(passenger)) manager->releasePassenger(passenger);
+        return;
+    }
+    if (doorsOpen && passenger->sourceFloor == currentFloor && hasRoomFor(*passenger)) {
+        boardPassenger(passenger);
+        return;
+    }
+    waiting.push_back(passenger);
+    plannedDropoffs[static_cast<size_t>(passenger->destinationFloor)]++;
+    addToQueue(passenger->sourceFloor);
+}
+
+void Elevator::setCapacity(int persons, double ratedLoad) {
+    capacity = max(0, persons);
+    ratedLoadKg = max(0.0, ratedLoad);
+    syncFleetView();
+}
+
+void Elevator::boardPassenger(Passenger* passenger) {
+    riders.push_back(passenger);
+    loadKg += passenger->weightKg;
+    ELEVATOR_METRIC(manager->getMetrics().passengerWait.record(manager->getTime() - passenger->requestedAt));
+    if (passenger->id >= 0) {
+        if (TripObserver* trips = manager->getTripObserver()) {
+            trips->onBoard(passenger->id, id, currentFloor, manager->getTime());
+        }
+    }
+    addCarCall(passenger->destinationFloor);
+}
+
+// A passenger this car cannot take goes back to the dispatcher through the intake,
+// the only route to other cars that is safe from a car's own event handler
+void Elevator::handBack(Passenger* passenger) {
+    plannedDropoffs[static_cast<size_t>(passenger->destinationFloor)]--;
+    if (!manager->submitPassenger(passenger)) {
+        LOG_WARN("Elevator " << id << " dropped passenger at floor " << passenger->sourceFloor
+                 << ": dispatcher is saturated");
+        manager->releasePassenger(passenger);
+    }
+}
+
+bool Elevator::willStopAt(int floor) const {
+    return pendingStops.contains(floor) ||
+           (StopSet::inRange(floor) && plannedDropoffs[static_cast<size_t>(floor)] > 0);
+}
+
+// LOOK order: nearest stop ahead in the current sweep, otherwise reverse
+int Elevator::nextStop() const {
+    if (pendingStops.contains(currentFloor)) return currentFloor;
+    int above = pendingStops.nextAbove(currentFloor);
+    int below = pendingStops.nextBelow(currentFloor);
+    if (sweepDirection == Direction::UP) {
+        return above != NO_FLOOR ? above : below;
+    }
+    return below != NO_FLOOR ? below : above;
+}
+
+// Starts the trip to the next stop; movement then advances one floor per event
+void Elevator::processQueue() {
+    if (pendingStops.empty()) return;
+    
+    int targetFloor = nextStop();
+    LOG_DEBUG("Elevator " << id << " processing request for floor " << targetFloor);
+    
+    if (targetFloor > currentFloor) {
+        sweepDirection = Direction::UP;
+        state->moveUp(*this);
+        manager->schedule(FLOOR_TRAVEL_TIME, EventType::FLOOR_ARRIVAL, this);
+    } else if (targetFloor < currentFloor) {
+        sweepDirection = Direction::DOWN;
+        state->moveDown(*this);
+        manager->schedule(FLOOR_TRAVEL_TIME, EventType::FLOOR_ARRIVAL, this);
+    } else {
+        pendingStops.remove(currentFloor);
+        doorsOpen = true;  // Already committed to opening; a call until then must not start a trip
+        syncFleetView();
+        manager->schedule(0, EventType::DOOR_OPEN, this, currentFloor);
+    }
+}
+
+// Stops at any pending floor on the way, including ones added mid-sweep
+void Elevator::onFloorArrival() {
+    currentFloor += (sweepDirection == Direction::UP) ? 1 : -1;
+    floorsTravelled++;
+    LOG_DEBUG("Elevator " << id << " is now at floor " << currentFloor
+              << " (t=" << manager->getTime() << "ms)");
+    logEvent(LogRecordKind::FLOOR_ARRIVAL, currentFloor);
+
+    if (pendingStops.contains(currentFloor) && isFull() && !carCalls.contains(currentFloor)) {
+        // Full-load bypass: nobody gets off here and nobody else fits, so the hall
+        // call goes back to the dispatcher instead of costing a stop
+        pendingStops.remove(currentFloor);
+        LOG_DEBUG("Elevator " << id << " is full, passing floor " << currentFloor);
+        size_t handedBack = 0;
+        for (size_t i = 0; i < waiting.size();) {
+            if (waiting[i]->sourceFloor == currentFloor) {
+                handBack(waiting[i]);
+                waiting.erase(waiting.begin() + static_cast<ptrdiff_t>(i));
+                handedBack++;
+            } else {
+                i++;
+            }
+        }
+        if (handedBack == 0 && !manager->submitHallCall(currentFloor, sweepDirection)) {
+            LOG_WARN("Elevator " << id << " dropped hall call at floor " << currentFloor
+                     << ": dispatcher is saturated");
+        }
+        continueAfterBypass();
+    } else if (pendingStops.remove(currentFloor)) {
+        parkingFloor = NO_FLOOR;
+        doorsOpen = true;  // See processQueue
+        state->stop(*this);
+        manager->schedule(0, EventType::DOOR_OPEN, this, currentFloor);
+    } else if (parkingFloor != NO_FLOOR && (parkingFloor == currentFloor || !pendingStops.empty())) {
+        // Parked, or a call assigned on the way has taken over the trip
+        bool parked = pendingStops.empty();
+        parkingFloor = NO_FLOOR;
+        if (parked) {
+            LOG_DEBUG("Elevator " << id << " parked at floor " << currentFloor);
+            state->stop(*this);
+        } else {
+            continueAfterBypass();
+        }
+    } else if (parkingFloor == NO_FLOOR && (sweepDirection == Direction::UP ? pendingStops.nextAbove(currentFloor)
+                                                                          : pendingStops.nextBelow(currentFloor)) == NO_FLOOR) {
+        continueAfterBypass();  // The stop this leg was heading for went to another car
+    } else {
+        syncFleetView();
+        manager->schedule(FLOOR_TRAVEL_TIME, EventType::FLOOR_ARRIVAL, this);
+    }
+}
+
+void Elevator::onDoorOpen() {
+    doorsOpen = true;
+    carCalls.remove(currentFloor);
+    LOG_DEBUG("Elevator " << id << " opened doors at floor " << currentFloor);
+    logEvent(LogRecordKind::DOOR_OPEN, currentFloor);
+#if ELEVATOR_METRICS
+    ElevatorMetrics& carMetrics = manager->getMetrics();
+    carMetrics.doorOpenings.fetch_add(1, memory_order_relaxed);
+    carMetrics.callServeTime.record(manager->getTime() - stopRequestedAt[static_cast<size_t>(currentFloor)]);
+#endif
+
+    TripObserver* trips = manager->getTripObserver();
+    size_t kept = 0;
+    for (Passenger* rider : riders) {
+        if (rider->destinationFloor != currentFloor) {
+            riders[kept++] = rider;
+            continue;
+        }
+        loadKg -= rider->weightKg;
+        if (trips && rider->id >= 0) trips->onAlight(rider->id, id, currentFloor, manager->getTime());
+        manager->releasePassenger(rider);
+    }
+    riders.resize(kept);
+    if (riders.empty()) loadKg = 0.0;  // No drift from repeated adds and subtracts
+
+    // Passengers waiting here board in arrival order while there is room; the rest
+    // are handed back when the doors close
+    kept = 0;
+    for (Passenger* passenger : waiting) {
+        if (passenger->sourceFloor == currentFloor && hasRoomFor(*passenger)) {
+            plannedDropoffs[static_cast<size_t>(passenger->destinationFloor)]--;
+            boardPassenger(passenger);
+        } else {
+            waiting[kept++] = passenger;
+        }
+    }
+    waiting.resize(kept);
+    syncFleetView();
+    manager->schedule(DOOR_DWELL_TIME, EventType::DOOR_CLOSE, this, currentFloor);
+}
+
+void Elevator::onDoorClose() {
+    doorsOpen = false;
+    LOG_DEBUG("Elevator " << id << " closed doors at floor " << currentFloor);
+    logEvent(LogRecordKind::DOOR_CLOSE, currentFloor);
+    size_t kept = 0;
+    for (Passenger* passenger : waiting) {
+        if (passenger->sourceFloor == currentFloor) handBack(passenger);
+        else waiting[kept++] = passenger;
+    }
+    waiting.resize(kept);
+    syncFleetView();
+    if (pendingStops.empty()) becomeIdle();
+    else processQueue();
+}
+
+// Resumes travel after passing a floor without stopping
+void Elevator::continueAfterBypass() {
+    int ahead = sweepDirection == Direction::UP ? pendingStops.nextAbove(currentFloor)
+                                                : pendingStops.nextBelow(currentFloor);
+    if (ahead != NO_FLOOR) {
+        syncFleetView();
+        manager->schedule(FLOOR_TRAVEL_TIME, EventType::FLOOR_ARRIVAL, this);
+    } else if (pendingStops.empty()) {
+        state->stop(*this);
+        becomeIdle();
+    } else {
+        processQueue();
+    }
+}
+
+bool Elevator::withdrawStop(int floor) {
+    if (!pendingStops.contains(floor) || carCalls.contains(floor) || plannedDropoffs[static_cast<size_t>(floor)] > 0) {
+        return false;
+    }
+    for (const Passenger* passenger : waiting) {
+        if (passenger->sourceFloor == floor) return false;
+    }
+    pendingStops.remove(floor);
+    LOG_DEBUG("Elevator " << id << " handed over its stop at floor " << floor);
+    syncFleetView();
+    return true;
+}
+
+bool Elevator::unassignPassenger(Passenger* passenger, bool keepStop) {
+    auto it = find(waiting.begin(), waiting.end(), passenger);
+    if (it == waiting.end()) return false;
+    waiting.erase(it);
+    plannedDropoffs[static_cast<size_t>(passenger->destinationFloor)]--;
+    if (!keepStop) withdrawStop(passenger->sourceFloor);
+    syncFleetView();
+    return true;
+}
+
+// Hall stops keep their floor and waiting passengers their trip. Riders, and whoever
+// pressed a car call without a tracked passenger, are let out here to ride on from
+// this floor. The car cannot know which way a hall call was going, so it guesses the
+// direction it would have been travelling when it got there.
+void Elevator::takeOutOfService(vector<HallCall>& displaced) {
+    if (!isInService()) return;
+    LOG_WARN("Elevator " << id << " out of service at floor " << currentFloor);
+    auto towards = [](int from, int to) { return to > from ? Direction::UP : Direction::DOWN; };
+    StopSet hallStops = pendingStops;
+    for (Passenger* passenger : waiting) {
+        hallStops.remove(passenger->sourceFloor);
+        displaced.push_back(HallCall{passenger->sourceFloor, towards(passenger->sourceFloor, passenger->destinationFloor),
+                                     passenger->destinationFloor, -1, passenger});
+    }
+    TripObserver* trips = manager->getTripObserver();
+    StopSet anonymous = carCalls;
+    for (Passenger* rider : riders) {
+        anonymous.remove(rider->destinationFloor);
+        if (rider->destinationFloor == currentFloor) {
+            // Doors were about to open for them
+            if (trips && rider->id >= 0) trips->onAlight(rider->id, id, currentFloor, manager->getTime());
+            manager->releasePassenger(rider);
+            continue;
+        }
+        rider->sourceFloor = currentFloor;
+        displaced.push_back(HallCall{currentFloor, towards(currentFloor, rider->destinationFloor),
+                                     rider->destinationFloor, -1, rider});
+    }
+    for (int floor = 0; floor < MAX_FLOORS; floor++) {
+        if (carCalls.contains(floor)) {
+            hallStops.remove(floor);
+            if (anonymous.contains(floor) && floor != currentFloor) {
+                displaced.push_back(HallCall{currentFloor, towards(currentFloor, floor), floor});
+            }
+        } else if (hallStops.contains(floor)) {
+            bool ahead = sweepDirection == Direction::UP ? floor >= currentFloor : floor <= currentFloor;
+            Direction opposite = sweepDirection == Direction::UP ? Direction::DOWN : Direction::UP;
+            displaced.push_back(HallCall{floor, ahead ? sweepDirection : opposite});
+        }
+    }
+
+    pendingStops = StopSet();
+    carCalls = StopSet();
+    waiting.clear();
+    riders.clear();
+    plannedDropoffs.fill(0);
+    loadKg = 0.0;
+    doorsOpen = false;
+    parkingFloor = NO_FLOOR;
+    setState(StateType::OUT_OF_SERVICE);
+}
+
+void Elevator::returnToService() {
+    if (isInService()) return;
+    LOG_INFO("Elevator " << id << " back in service at floor " << currentFloor);
+    setState(StateType::IDLE);
+    becomeIdle();
+}
+
+void Elevator::saveTo(CarSnapshot& record) const {
+    memset(&record, 0, sizeof(record));
+    record.id = id;
+    record.currentFloor = currentFloor;
+    record.parkingFloor = parkingFloor;
+    record.capacity = capacity;
+    record.state = static_cast<uint8_t>(stateType);
+    record.sweepDirection = static_cast<uint8_t>(sweepDirection);
+    record.doorsOpen = doorsOpen ? 1 : 0;
+    record.floorsTravelled = floorsTravelled;
+    record.ratedLoadKg = ratedLoadKg;
+    record.waitingCount = static_cast<uint32_t>(waiting.size());
+    record.riderCount = static_cast<uint32_t>(riders.size());
+    for (int w = 0; w < STOP_WORDS; w++) {
+        record.pendingStops[w] = pendingStops.word(w);
+        record.carCalls[w] = carCalls.word(w);
+    }
+}
+
+// Restores the car exactly as saved; its pending events come back separately
+void Elevator::restoreFrom(const CarSnapshot& record, vector<Passenger*> waitingPassengers,
+                           vector<Passenger*> ridingPassengers) {
+    currentFloor = record.currentFloor;
+    parkingFloor = record.parkingFloor;
+    capacity = record.capacity;
+    ratedLoadKg = record.ratedLoadKg;
+    stateType = static_cast<StateType>(record.state);
+    state = getBuiltinState(stateType);
+    customState.reset();
+    sweepDirection = static_cast<Direction>(record.sweepDirection);
+    doorsOpen = record.doorsOpen != 0;
+    floorsTravelled = record.floorsTravelled;
+    for (int w = 0; w < STOP_WORDS; w++) {
+        pendingStops.setWord(w, record.pendingStops[w]);
+        carCalls.setWord(w, record.carCalls[w]);
+    }
+    waiting = std::move(waitingPassengers);
+    riders = std::move(ridingPassengers);
+    plannedDropoffs.fill(0);
+    for (const Passenger* passenger : waiting) plannedDropoffs[static_cast<size_t>(passenger->destinationFloor)]++;
+    loadKg = 0.0;
+    for (const Passenger* passenger : riders) loadKg += passenger->weightKg;
+#if ELEVATOR_METRICS
+    stopRequestedAt.fill(manager->getTime());  // Serve times restart at the restore
+#endif
+    syncFleetView();
+}
+
+// Out of work; the dispatcher may send the car somewhere better to wait
+void Elevator::becomeIdle() {
+    if (manager->hasParkingStrategy() && !manager->submitIdleCar(fleetIndex)) {
+        LOG_DEBUG("Elevator " << id << " stays at floor " << currentFloor << ": dispatcher is saturated");
+    }
+}
+
+void Elevator::parkAt(int floor) {
+    if (!isVacant() || !StopSet::inRange(floor) || floor == currentFloor) return;
+    LOG_DEBUG("Elevator " << id << " parking at floor " << floor);
+    parkingFloor = floor;
+    if (floor > currentFloor) {
+        sweepDirection = Direction::UP;
+        state->moveUp(*this);
+    } else {
+        sweepDirection = Direction::DOWN;
+        state->moveDown(*this);
+    }
+    manager->schedule(FLOOR_TRAVEL_TIME, EventType::FLOOR_ARRIVAL, this);
+}
+
+// State Implementations
+void IdleState::moveUp(Elevator& elevator) {
+    elevator.setState(StateType::MOVING_UP);
+}
+
+void IdleState::moveDown(Elevator& elevator) {
+    elevator.setState(StateType::MOVING_DOWN);
+}
+
+void MovingUpState::moveDown(Elevator& elevator) {
+    elevator.setState(StateType::MOVING_DOWN);
+}
+
+void MovingUpState::stop(Elevator& elevator) {
+    elevator.setState(StateType::IDLE);
+}
+
+void MovingDownState::moveUp(Elevator& elevator) {
+    elevator.setState(StateType::MOVING_UP);
+}
+
+void MovingDownState::stop(Elevator& elevator) {
+    elevator.setState(StateType::IDLE);
+}
+
+// Routes a popped event to the car (or dispatcher) it belongs to
+void ElevatorManager::dispatch(const Event& event) {
+    switch (event.type) {
+        case EventType::HALL_CALL: addToQueue(event.floor, event.direction); break;
+        case EventType::FLOOR_ARRIVAL: event.elevator->onFloorArrival(); break;
+        case EventType::DOOR_OPEN: event.elevator->onDoorOpen(); break;
+        case EventType::DOOR_CLOSE: event.elevator->onDoorClose(); break;
+    }
+}
+
+EventQueue& ElevatorManager::queueFor(const Elevator* elevator) {
+    if (shards.empty() || !elevator) return events;
+    return shards[static_cast<size_t>(elevator->getFleetIndex()) / carsPerShard];
+}
+
+// Car events only touch their own car, so between two dispatch boundaries each shard
+// of cars can be advanced independently, as one WorkStealingPool task per shard; an
+// idle worker takes over whole shards, not queued calls. Hall calls stay in the main
+// queue and are dispatched on this thread at boundaries, which are at most `epoch`
+// apart and also fall on every scheduled hall call; panel calls therefore wait at
+// most one epoch.
+void ElevatorManager::runParallel(size_t workerCount, SimTime until, SimTime epoch, size_t shardSize) {
+    if (elevators.empty() || workerCount == 0) {
+        runUntil(until);
+        return;
+    }
+
+    carsPerShard = max<size_t>(1, shardSize);
+    shards = vector<EventQueue>((elevators.size() + carsPerShard - 1) / carsPerShard);
+    SimTime now = events.getTime();
+    for (EventQueue& shard : shards) shard.advanceTo(now);
+    for (const Event& event : events.takeAll()) {
+        queueFor(event.elevator).schedule(event.time, event.type, event.elevator, event.floor, event.direction);
+    }
+
+    WorkStealingPool pool(workerCount);
+    while (now <= until) {
+        events.advanceTo(now);
+        for (EventQueue& shard : shards) shard.advanceTo(now);
+
+        drainIntake();
+        while (!events.empty() && events.nextTime() <= now) {
+            dispatch(events.pop());
+        }
+
+        SimTime nextCarEvent = LLONG_MAX;
+        for (const EventQueue& shard : shards) {
+            if (!shard.empty()) nextCarEvent = min(nextCarEvent, shard.nextTime());
+        }
+        SimTime nextHallCall = events.empty() ? LLONG_MAX : events.nextTime();
+        if (nextCarEvent == LLONG_MAX && nextHallCall == LLONG_MAX) break;
+        if (nextCarEvent > now) {
+            now = min(nextCarEvent, nextHallCall);
+            continue;
+        }
+
+        SimTime boundary = min(nextHallCall, now + epoch);
+        if (until < LLONG_MAX) boundary = min(boundary, until + 1);
+        pool.runAll(shards.size(), [&](size_t index) {
+            EventQueue& shard = shards[index];
+            runningShard() = &shard;
+            while (!shard.empty() && shard.nextTime() < boundary) {
+                dispatch(shard.pop());
+            }
+            runningShard() = nullptr;
+        });
+        flushNotifications();
+        now = boundary;
+    }
+    flushNotifications();
+
+    // Hand every car's remaining events back to the sequential queue
+    vector<EventQueue> finished;
+    finished.swap(shards);
+    events.advanceTo(min(now, until));
+    for (EventQueue& shard : finished) {
+        for (const Event& event : shard.takeAll()) {
+            events.schedule(event.time, event.type, event.elevator, event.floor, event.direction);
+        }
+    }
+}
+
+// A repeated press of a pending call replaces its entry; the car first picked keeps its stop
+void ElevatorManager::trackAssignment(int floor, Direction direction, int car) {
+    int& slot = assignmentSlot[static_cast<size_t>(floor * 2 + static_cast<int>(direction))];
+    PendingAssignment assignment{floor, direction, car, redispatchCost.cost(*elevators[static_cast<size_t>(car)], floor, direction)};
+    if (slot >= 0) {
+        assignments[static_cast<size_t>(slot)] = assignment;
+    } else {
+        slot = static_cast<int>(assignments.size());
+        assignments.push_back(assignment);
+    }
+}
+
+void ElevatorManager::dropAssignment(size_t index) {
+    const PendingAssignment& dropped = assignments[index];
+    assignmentSlot[static_cast<size_t>(dropped.floor * 2 + static_cast<int>(dropped.direction))] = -1;
+    assignments[index] = assignments.back();
+    assignments.pop_back();
+    if (index < assignments.size()) {
+        const PendingAssignment& moved = assignments[index];
+        assignmentSlot[static_cast<size_t>(moved.floor * 2 + static_cast<int>(moved.direction))] = static_cast<int>(index);
+    }
+}
+
+// Incremental re-optimization. Only cars whose FleetView slot changed since the last
+// pass can have changed cost, so each pending call is re-priced against those cars
+// alone. A call whose own car changed is re-priced against the whole fleet, since its
+// current cost may now exceed the costs of cars it was compared with before. Calls
+// move only for a gain above the hysteresis, so two cars cannot trade one back and forth.
+void ElevatorManager::redispatch() {
+    vector<int> dirty;
+    for (size_t i = 0; i < redispatchDirty.size(); i++) {
+        if (!redispatchDirty[i]) continue;
+        redispatchDirty[i] = 0;
+        dirty.push_back(static_cast<int>(i));
+    }
+    if (dirty.empty()) return;
+    vector<char> changed(elevators.size(), 0);
+    for (int car : dirty) changed[static_cast<size_t>(car)] = 1;
+
+    for (size_t a = 0; a < assignments.size();) {
+        PendingAssignment& assignment = assignments[a];
+        Elevator& current = *elevators[static_cast<size_t>(assignment.car)];
+        if (!current.hasPendingStop(assignment.floor)) {
+            dropAssignment(a);  // Served, or its stop was merged into another call's
+            continue;
+        }
+        bool ownChanged = changed[static_cast<size_t>(assignment.car)] != 0;
+        if (ownChanged) assignment.cost = redispatchCost.cost(current, assignment.floor, assignment.direction);
+
+        int best = assignment.car;
+        double bestCost = assignment.cost - redispatchHysteresis;
+        auto consider = [&](int car) {
+            if (car == assignment.car || !elevators[static_cast<size_t>(car)]->isInService()) return;
+            double carCost = redispatchCost.cost(*elevators[static_cast<size_t>(car)], assignment.floor, assignment.direction);
+            if (carCost < bestCost) {
+                best = car;
+                bestCost = carCost;
+            }
+        };
+        if (ownChanged) {
+            for (size_t car = 0; car < elevators.size(); car++) consider(static_cast<int>(car));
+        } else {
+            for (int car : dirty) consider(car);
+        }
+
+        // The stop stays put if it also serves another pending call or a passenger of its car
+        int other = assignmentSlot[static_cast<size_t>(assignment.floor * 2 + 1 - static_cast<int>(assignment.direction))];
+        bool shared = other >= 0 && assignments[static_cast<size_t>(other)].car == assignment.car;
+        if (best != assignment.car && !shared && current.withdrawStop(assignment.floor)) {
+            Elevator& target = *elevators[static_cast<size_t>(best)];
+            LOG_DEBUG("Re-dispatching floor " << assignment.floor << " from elevator " << current.getId()
+                      << " to elevator " << target.getId());
+            target.addToQueue(assignment.floor);
+            assignment.car = best;
+            assignment.cost = bestCost;
+            redispatched++;
+        }
+        a++;
+    }
+
+    // Destination-dispatch passengers still waiting are re-priced the same way
+    vector<Passenger*> candidates;
+    for (size_t c = 0; c < elevators.size(); c++) {
+        Elevator& current = *elevators[c];
+        candidates = current.getWaitingPassengers();
+        for (Passenger* passenger : candidates) {
+            int source = passenger->sourceFloor;
+            if (current.areDoorsOpen() && current.getCurrentFloor() == source) continue;  // Boarding now
+            Direction direction = passenger->destinationFloor > source ? Direction::UP : Direction::DOWN;
+            double ownCost = redispatchCost.cost(current, source, direction);
+            int best = static_cast<int>(c);
+            double bestCost = ownCost - redispatchHysteresis;
+            auto consider = [&](size_t car) {
+                if (car == c) return;
+                const Elevator& other = *elevators[car];
+                if (other.isFull() || !other.isInService()) return;
+                double carCost = redispatchCost.cost(other, source, direction);
+                if (carCost < bestCost) {
+                    best = static_cast<int>(car);
+                    bestCost = carCost;
+                }
+            };
+            if (changed[c]) {
+                for (size_t car = 0; car < elevators.size(); car++) consider(car);
+            } else {
+                for (int car : dirty) consider(static_cast<size_t>(car));
+            }
+            if (best == static_cast<int>(c)) continue;
+            bool hallCallHere = false;
+            for (int d = 0; d < 2; d++) {
+                int slot = assignmentSlot[static_cast<size_t>(source * 2 + d)];
+                hallCallHere = hallCallHere || (slot >= 0 && assignments[static_cast<size_t>(slot)].car == static_cast<int>(c));
+            }
+            if (current.unassignPassenger(passenger, hallCallHere)) {
+                elevators[static_cast<size_t>(best)]->assignPassenger(passenger);
+                redispatched++;
+            }
+        }
+    }
+}
+
+void ElevatorManager::rebuildServiceView() {
+    serviceCars.clear();
+    serviceIndex.clear();
+    serviceSlot.assign(elevators.size(), -1);
+    if (outOfService == 0) return;
+    serviceFleet.resize(elevators.size() - outOfService);
+    for (size_t i = 0; i < elevators.size(); i++) {
+        if (!elevators[i]->isInService()) continue;
+        serviceSlot[i] = static_cast<int>(serviceCars.size());
+        serviceFleet.copySlot(serviceCars.size(), fleet, i);
+        serviceCars.push_back(elevators[i]);
+        serviceIndex.push_back(static_cast<int>(i));
+    }
+}
+
+int ElevatorManager::selectFor(int floor, Direction direction) {
+    if (outOfService == 0) return selectionStrategy->selectElevatorIndex(floor, direction, fleet, elevators);
+    if (serviceCars.empty()) return -1;
+    int selected = selectionStrategy->selectElevatorIndex(floor, direction, serviceFleet, serviceCars);
+    return selected >= 0 ? serviceIndex[static_cast<size_t>(selected)] : -1;
+}
+
+int ElevatorManager::selectForDestination(const HallCall& call) {
+    if (outOfService == 0) return selectionStrategy->selectElevatorForDestination(call, fleet, elevators);
+    if (serviceCars.empty()) return -1;
+    int selected = selectionStrategy->selectElevatorForDestination(call, serviceFleet, serviceCars);
+    return selected >= 0 ? serviceIndex[static_cast<size_t>(selected)] : -1;
+}
+
+void ElevatorManager::selectBatch(const HallCall* calls, size_t count, int* selected) {
+    if (outOfService == 0) {
+        selectionStrategy->selectElevatorBatch(calls, count, fleet, elevators, selected);
+        return;
+    }
+    if (serviceCars.empty()) {
+        fill(selected, selected + count, -1);
+        return;
+    }
+    selectionStrategy->selectElevatorBatch(calls, count, serviceFleet, serviceCars, selected);
+    for (size_t c = 0; c < count; c++) {
+        if (selected[c] >= 0) selected[c] = serviceIndex[static_cast<size_t>(selected[c])];
+    }
+}
+
+size_t ElevatorManager::takeOutOfService(const ElevatorHandle* cars, size_t count) {
+    vector<char> failing(elevators.size(), 0);
+    size_t failed = 0;
+    for (size_t c = 0; c < count; c++) {
+        size_t i = static_cast<size_t>(cars[c].index);
+        if (i >= elevators.size() || failing[i] || !elevators[i]->isInService()) continue;
+        failing[i] = 1;
+        failed++;
+    }
+    if (failed == 0) return 0;
+
+    // One pass over each queue however many cars fail together
+    auto ownedByFailed = [&](const Event& event) {
+        return event.elevator && failing[static_cast<size_t>(event.elevator->getFleetIndex())];
+    };
+    events.removeIf(ownedByFailed);
+    for (EventQueue& shard : shards) shard.removeIf(ownedByFailed);
+
+    vector<HallCall> displaced;
+    for (size_t i = 0; i < elevators.size(); i++) {
+        if (!failing[i]) continue;
+        size_t first = displaced.size();
+        elevators[i]->takeOutOfService(displaced);
+        size_t last = displaced.size();
+        // A tracked hall call knows its direction, where the car could only guess it
+        for (size_t d = first; d < last && redispatchInterval > 0; d++) {
+            if (displaced[d].hasDestination()) continue;
+            int floor = displaced[d].floor;
+            auto tracked = [&](Direction direction) {
+                int slot = assignmentSlot[static_cast<size_t>(floor * 2 + static_cast<int>(direction))];
+                return slot >= 0 && assignments[static_cast<size_t>(slot)].car == static_cast<int>(i);
+            };
+            bool up = tracked(Direction::UP), down = tracked(Direction::DOWN);
+            if (up && down) {
+                displaced[d].direction = Direction::UP;
+                displaced.push_back(HallCall{floor, Direction::DOWN});
+            } else if (up || down) {
+                displaced[d].direction = up ? Direction::UP : Direction::DOWN;
+            }
+        }
+    }
+    for (size_t a = 0; a < assignments.size();) {
+        if (failing[static_cast<size_t>(assignments[a].car)]) dropAssignment(a);
+        else a++;
+    }
+    outOfService += failed;
+    rebuildServiceView();
+    LOG_WARN(failed << " elevator(s) out of service, re-routing " << displaced.size() << " calls");
+
+    vector<int> selected(displaced.size());
+    selectBatch(displaced.data(), displaced.size(), selected.data());
+    for (size_t c = 0; c < displaced.size(); c++) {
+        const HallCall& call = displaced[c];
+        if (selected[c] < 0) {
+            LOG_WARN("No elevator in service for the call at floor " << call.floor);
+            if (call.passenger) releasePassenger(call.passenger);
+            continue;
+        }
+        Elevator& target = *elevators[static_cast<size_t>(selected[c])];
+        if (call.passenger) {
+            target.assignPassenger(call.passenger);
+        } else if (call.hasDestination()) {
+            target.addDestinationCall(call.floor, call.destinationFloor);
+        } else {
+            target.addToQueue(call.floor);
+            if (redispatchInterval > 0) trackAssignment(call.floor, call.direction, selected[c]);
+        }
+    }
+    migrated += displaced.size();
+    return displaced.size();
+}
+
+// The car starts idle where it stopped; calls reach it as new ones arrive, or sooner
+// through re-dispatch
+void ElevatorManager::returnToService(ElevatorHandle car) {
+    if (car.index < 0 || static_cast<size_t>(car.index) >= elevators.size()) return;
+    Elevator& elevator = *elevators[static_cast<size_t>(car.index)];
+    if (elevator.isInService()) return;
+    outOfService--;
+    elevator.returnToService();
+    rebuildServiceView();
+}
+
+int ElevatorManager::subscriberId(ElevatorObserver* observer) {
+    auto it = subscriberIds.find(observer);
+    if (it != subscriberIds.end()) return it->second;
+    int id = static_cast<int>(subscribers.size());
+    subscribers.push_back(observer);
+    coalescedSlot.push_back(-1);
+    subscriberIds[observer] = id;
+    return id;
+}
+
+// Later updates in the same flush overwrite earlier ones for that subscriber
+void ElevatorManager::queueNotification(int subscriber, int floor, StateType state) {
+    int& slot = coalescedSlot[static_cast<size_t>(subscriber)];
+    if (slot < 0) {
+        slot = static_cast<int>(coalesced.size());
+        coalesced.push_back(Notification{subscriber, floor, state});
+    } else {
+        coalesced[static_cast<size_t>(slot)].floor = floor;
+        coalesced[static_cast<size_t>(slot)].state = state;
+    }
+}
+
+void ElevatorManager::flushNotifications() {
+    if (!notificationsPending.exchange(false)) return;
+    for (size_t i = 0; i < dirtyCars.size(); i++) {
+        if (!dirtyCars[i]) continue;
+        dirtyCars[i] = 0;
+        int floor = fleet.currentFloor[i];
+        StateType state = static_cast<StateType>(fleet.state[i]);
+        for (int subscriber : carSubscribers[i]) {
+            queueNotification(subscriber, floor, state);
+        }
+        if (floor >= 0 && floor < MAX_FLOORS) {
+            for (int subscriber : floorSubscribers[static_cast<size_t>(floor)]) {
+                queueNotification(subscriber, floor, state);
+            }
+        }
+    }
+    for (const Notification& notification : coalesced) {
+        coalescedSlot[static_cast<size_t>(notification.subscriber)] = -1;
+        ElevatorObserver* observer = subscribers[static_cast<size_t>(notification.subscriber)];
+        if (observer) observer->update(notification.floor, notification.state);
+    }
+    coalesced.clear();
+}
+
+// Defined once OuterPanel is complete so the panel arena can destroy its panels
+ElevatorManager::~ElevatorManager() = default;
+
+PanelHandle ElevatorManager::createPanels(int lowestFloor, int highestFloor) {
+    PanelHandle first{static_cast<int>(panels.size())};
+    if (highestFloor < lowestFloor) return first;
+    size_t count = static_cast<size_t>(highestFloor - lowestFloor + 1);
+    ownedPanels.reserve(count);
+    panels.reserve(panels.size() + count);
+    observers.reserve(observers.size() + count);
+    for (int floor = lowestFloor; floor <= highestFloor; floor++) {
+        addPanel(ownedPanels.create(floor, this));
+    }
+    return first;
+}
+
+void ElevatorManager::addInnerPanel(Elevator& elevator) {
+    size_t index = static_cast<size_t>(elevator.getFleetIndex());
+    if (innerPanels.size() <= index) innerPanels.resize(index + 1, nullptr);
+    InnerPanel* panel = ownedInnerPanels.create(&elevator, this);
+    innerPanels[index] = panel;
+    subscribeToCar(panel, elevator.getFleetIndex());
+}
+
+// Implement addPanel after OuterPanel is fully defined
+void ElevatorManager::addPanel(OuterPanel* panel) {
+    panels.push_back(panel);
+    observers.push_back(panel);
+    subscribeToFloor(panel, panel->getFloor());
+}
+
+// Trace Replay Benchmark
+
+// One passenger of a traffic trace: appears at `time` and rides source -> destination
+struct TraceCall {
+    SimTime time;
+    int sourceFloor;
+    int destinationFloor;
+};
+
+enum class TrafficProfile { UP_PEAK, DOWN_PEAK, LUNCH, POISSON };
+
+bool parseTrafficProfile(const string& name, TrafficProfile& profile) {
+    if (name == "up-peak") profile = TrafficProfile::UP_PEAK;
+    else if (name == "down-peak") profile = TrafficProfile::DOWN_PEAK;
+    else if (name == "lunch") profile = TrafficProfile::LUNCH;
+    else if (name == "poisson") profile = TrafficProfile::POISSON;
+    else return false;
+    return true;
+}
+
+// Synthetic trace over floors 1..floors with floor 1 as the lobby. Arrivals are
+// Poisson with a mean gap of `meanGap` ms; the same seed gives the same trace.
+vector<TraceCall> generateTrace(TrafficProfile profile, int floors, size_t count, SimTime meanGap,
+                                unsigned seed) {
+    mt19937 rng(seed);
+    exponential_distribution<double> gap(1.0 / static_cast<double>(max<SimTime>(1, meanGap)));
+    uniform_int_distribution<int> upperFloor(2, max(2, floors));
+    uniform_int_distribution<int> anyFloor(1, max(2, floors));
+    uniform_real_distribution<double> mix(0.0, 1.0);
+
+    vector<TraceCall> trace;
+    trace.reserve(count);
+    double time = 0.0;
+    while (trace.size() < count) {
+        time += gap(rng);
+        int source = 1;
+        int destination = 1;
+        switch (profile) {
+            case TrafficProfile::UP_PEAK:
+                destination = upperFloor(rng);
+                break;
+            case TrafficProfile::DOWN_PEAK:
+                source = upperFloor(rng);
+                break;
+            case TrafficProfile::LUNCH: {
+                // Out to and back from the lobby, with some inter-floor trips
+                double kind = mix(rng);
+                if (kind < 0.4) source = upperFloor(rng);
+                else if (kind < 0.8) destination = upperFloor(rng);
+                else {
+                    source = anyFloor(rng);
+                    destination = anyFloor(rng);
+                }
+                break;
+            }
+            case TrafficProfile::POISSON:
+                source = anyFloor(rng);
+                destination = anyFloor(rng);
+                break;
+        }
+        if (source == destination) continue;
+        trace.push_back(TraceCall{static_cast<SimTime>(time), source, destination});
+    }
+    return trace;
+}
+
+// Recorded trace: one "time_ms source destination" triple per line, '#' starts a comment
+bool loadTrace(const string& path, vector<TraceCall>& trace) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+        istringstream fields(line);
+        TraceCall call;
+        if (!(fields >> call.time >> call.sourceFloor >> call.destinationFloor)) continue;
+        if (call.sourceFloor == call.destinationFloor) continue;
+        trace.push_back(call);
+    }
+    stable_sort(trace.begin(), trace.end(),
+                [](const TraceCall& a, const TraceCall& b) { return a.time < b.time; });
+    return true;
+}
+
+// Destination calls recorded in a binary event log, in file order
+bool loadTraceFromEventLog(const string& path, vector<TraceCall>& trace) {
+    MappedEventLog log;
+    if (!log.open(path)) return false;
+    for (const LogRecord& record : log) {
+        if (record.kind == LogRecordKind::DESTINATION_CALL && record.floor != record.extra) {
+            trace.push_back(TraceCall{record.time, record.floor, record.extra});
+        }
+    }
+    return true;
+}
+
+// Built-in strategies by command-line name; nullptr if unknown
+unique_ptr<ElevatorSelectionStrategy> makeSelectionStrategy(const string& name) {
+    if (name == "nearest") return unique_ptr<ElevatorSelectionStrategy>(new NearestElevatorStrategy());
+    if (name == "vectorized") return unique_ptr<ElevatorSelectionStrategy>(new VectorizedNearestStrategy());
+    if (name == "destination") return unique_ptr<ElevatorSelectionStrategy>(new DestinationDispatchStrategy());
+    if (name == "eta") return unique_ptr<ElevatorSelectionStrategy>(new EtaCostStrategy());
+    if (name == "load") return unique_ptr<ElevatorSelectionStrategy>(new LoadAwareStrategy());
+    if (name == "batch") return unique_ptr<ElevatorSelectionStrategy>(new BatchAssignmentStrategy());
+    return nullptr;
+}
+
+// Parking policies by command-line name; nullptr for "none" or unknown, see isParkingName
+unique_ptr<ParkingStrategy> makeParkingStrategy(const string& name) {
+    if (name == "predictive") return unique_ptr<ParkingStrategy>(new PredictiveParkingStrategy());
+    return nullptr;
+}
+
+bool isParkingName(const string& name) {
+    return name.empty() || name == "none" || makeParkingStrategy(name) != nullptr;
+}
+
+// Snapshot Implementation
+
+void ElevatorManager::writeSnapshot(vector<char>& image) {
+    drainIntake();
+    vector<Event> pending = events.takeAll();
+    for (const Event& event : pending) {
+        events.schedule(event.time, event.type, event.elevator, event.floor, event.direction);
+    }
+    vector<double> parameters = selectionStrategy->getParameters();
+    size_t passengerCount = 0;
+    for (const Elevator* elevator : elevators) {
+        passengerCount += elevator->getWaitingPassengers().size() + elevator->getRiders().size();
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.maxFloors = MAX_FLOORS;
+    header.time = events.getTime();
+    header.carCount = static_cast<uint32_t>(elevators.size());
+    header.passengerCount = static_cast<uint32_t>(passengerCount);
+    header.eventCount = static_cast<uint32_t>(pending.size());
+    header.parameterCount = static_cast<uint32_t>(parameters.size());
+    strncpy(header.strategy, selectionStrategy->getName(), sizeof(header.strategy) - 1);
+    header.redispatchInterval = redispatchInterval;
+    header.nextRedispatch = nextRedispatch;
+    header.redispatchHysteresis = redispatchHysteresis;
+    header.assignmentCount = static_cast<uint32_t>(assignments.size());
+
+    image.resize(sizeof(SnapshotHeader) + parameters.size() * sizeof(double) +
+                 elevators.size() * sizeof(CarSnapshot) + passengerCount * sizeof(PassengerSnapshot) +
+                 pending.size() * sizeof(EventSnapshot) + assignments.size() * sizeof(AssignmentSnapshot));
+    char* out = image.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (!parameters.empty()) memcpy(out, parameters.data(), parameters.size() * sizeof(double));
+    out += parameters.size() * sizeof(double);
+
+    CarSnapshot* cars = reinterpret_cast<CarSnapshot*>(out);
+    PassengerSnapshot* passengers = reinterpret_cast<PassengerSnapshot*>(cars + elevators.size());
+    for (size_t i = 0; i < elevators.size(); i++) {
+        elevators[i]->saveTo(cars[i]);
+        cars[i].redispatchDirty = redispatchDirty[i];
+        for (const vector<Passenger*>* group : {&elevators[i]->getWaitingPassengers(), &elevators[i]->getRiders()}) {
+            for (const Passenger* passenger : *group) {
+                *passengers++ = PassengerSnapshot{passenger->id, passenger->sourceFloor, passenger->destinationFloor,
+                                                  0, passenger->requestedAt, passenger->weightKg};
+            }
+        }
+    }
+    EventSnapshot* saved = reinterpret_cast<EventSnapshot*>(passengers);
+    for (const Event& event : pending) {
+        EventSnapshot record;
+        memset(&record, 0, sizeof(record));
+        record.time = event.time;
+        record.car = event.elevator ? event.elevator->getFleetIndex() : -1;
+        record.floor = event.floor;
+        record.type = static_cast<uint8_t>(event.type);
+        record.direction = static_cast<uint8_t>(event.direction);
+        *saved++ = record;
+    }
+    AssignmentSnapshot* tracked = reinterpret_cast<AssignmentSnapshot*>(saved);
+    for (const PendingAssignment& assignment : assignments) {
+        AssignmentSnapshot record;
+        memset(&record, 0, sizeof(record));
+        record.floor = assignment.floor;
+        record.car = assignment.car;
+        record.cost = assignment.cost;
+        record.direction = static_cast<uint8_t>(assignment.direction);
+        *tracked++ = record;
+    }
+}
+
+bool ElevatorManager::restoreSnapshot(const char* image, size_t size) {
+    if (!elevators.empty() || size < sizeof(SnapshotHeader)) return false;
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(image);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->maxFloors != static_cast<uint32_t>(MAX_FLOORS)) {
+        return false;
+    }
+    size_t expected = sizeof(SnapshotHeader) + header->parameterCount * sizeof(double) +
+                      header->carCount * sizeof(CarSnapshot) + header->passengerCount * sizeof(PassengerSnapshot) +
+                      header->eventCount * sizeof(EventSnapshot) + header->assignmentCount * sizeof(AssignmentSnapshot);
+    if (size != expected) return false;
+
+    const char* in = image + sizeof(SnapshotHeader);
+    const double* parameterData = reinterpret_cast<const double*>(in);
+    const CarSnapshot* cars = reinterpret_cast<const CarSnapshot*>(parameterData + header->parameterCount);
+    const PassengerSnapshot* passengers = reinterpret_cast<const PassengerSnapshot*>(cars + header->carCount);
+    const EventSnapshot* saved = reinterpret_cast<const EventSnapshot*>(passengers + header->passengerCount);
+    const AssignmentSnapshot* tracked = reinterpret_cast<const AssignmentSnapshot*>(saved + header->eventCount);
+
+    // Validate everything that indexes an array before touching the manager
+    size_t passengerTotal = 0;
+    for (uint32_t i = 0; i < header->carCount; i++) {
+        const CarSnapshot& car = cars[i];
+        if (!StopSet::inRange(car.currentFloor) || car.state > static_cast<uint8_t>(StateType::OUT_OF_SERVICE) ||
+            car.sweepDirection > static_cast<uint8_t>(Direction::DOWN) ||
+            (car.parkingFloor != NO_FLOOR && !StopSet::inRange(car.parkingFloor))) {
+            return false;
+        }
+        for (int w = 0; w < STOP_WORDS; w++) {
+            if ((car.pendingStops[w] | car.carCalls[w]) & ~StopSet::wordMask(w)) return false;  // Stops past the top
+        }
+        passengerTotal += car.waitingCount + car.riderCount;
+    }
+    if (passengerTotal != header->passengerCount) return false;
+    for (uint32_t p = 0; p < header->passengerCount; p++) {
+        if (!StopSet::inRange(passengers[p].sourceFloor) || !StopSet::inRange(passengers[p].destinationFloor)) {
+            return false;
+        }
+    }
+    for (uint32_t e = 0; e < header->eventCount; e++) {
+        if (saved[e].type > static_cast<uint8_t>(EventType::DOOR_CLOSE) ||
+            saved[e].direction > static_cast<uint8_t>(Direction::DOWN) || !StopSet::inRange(saved[e].floor) ||
+            saved[e].car < -1 || saved[e].car >= static_cast<int32_t>(header->carCount) ||
+            (saved[e].car < 0) != (saved[e].type == static_cast<uint8_t>(EventType::HALL_CALL))) {
+            return false;
+        }
+    }
+    if (header->redispatchInterval < 0 || (header->redispatchInterval == 0 && header->assignmentCount > 0)) return false;
+    vector<char> slotTaken(assignmentSlot.size(), 0);
+    for (uint32_t a = 0; a < header->assignmentCount; a++) {
+        if (!StopSet::inRange(tracked[a].floor) || tracked[a].direction > static_cast<uint8_t>(Direction::DOWN) ||
+            tracked[a].car < 0 || tracked[a].car >= static_cast<int32_t>(header->carCount)) {
+            return false;
+        }
+        char& taken = slotTaken[static_cast<size_t>(tracked[a].floor * 2 + tracked[a].direction)];
+        if (taken) return false;  // One entry per floor and direction
+        taken = 1;
+    }
+
+    string strategyName(header->strategy, strnlen(header->strategy, sizeof(header->strategy)));
+    if (strategyName != selectionStrategy->getName()) {
+        unique_ptr<ElevatorSelectionStrategy> named = makeSelectionStrategy(strategyName);
+        if (named) selectionStrategy = std::move(named);
+        else LOG_WARN("Snapshot strategy " << strategyName << " is unknown; keeping " << selectionStrategy->getName());
+    }
+    selectionStrategy->setParameters(vector<double>(parameterData, parameterData + header->parameterCount));
+
+    events.advanceTo(header->time);
+    ownedElevators.reserve(header->carCount);
+    ownedInnerPanels.reserve(header->carCount);
+    for (uint32_t i = 0; i < header->carCount; i++) {
+        const CarSnapshot& car = cars[i];
+        addElevator(ownedElevators.create(car.id, this));
+        addInnerPanel(*elevators.back());
+        vector<Passenger*> groups[2];
+        for (int group = 0; group < 2; group++) {
+            uint32_t count = group == 0 ? car.waitingCount : car.riderCount;
+            groups[group].reserve(count);
+            for (uint32_t p = 0; p < count; p++, passengers++) {
+                groups[group].push_back(passengerPool.acquire(Passenger{passengers->id, passengers->sourceFloor,
+                                                                        passengers->destinationFloor,
+                                                                        passengers->requestedAt, passengers->weightKg}));
+            }
+        }
+        elevators.back()->restoreFrom(car, std::move(groups[0]), std::move(groups[1]));
+        if (!elevators.back()->isInService()) outOfService++;
+    }
+    rebuildServiceView();
+    for (uint32_t e = 0; e < header->eventCount; e++) {
+        Elevator* car = saved[e].car >= 0 ? elevators[static_cast<size_t>(saved[e].car)] : nullptr;
+        events.schedule(saved[e].time, static_cast<EventType>(saved[e].type), car, saved[e].floor,
+                        static_cast<Direction>(saved[e].direction));
+    }
+    redispatchInterval = header->redispatchInterval;
+    nextRedispatch = header->nextRedispatch;
+    redispatchHysteresis = header->redispatchHysteresis;
+    for (uint32_t a = 0; a < header->assignmentCount; a++) {
+        assignmentSlot[static_cast<size_t>(tracked[a].floor * 2 + tracked[a].direction)] = static_cast<int>(assignments.size());
+        assignments.push_back(PendingAssignment{tracked[a].floor, static_cast<Direction>(tracked[a].direction),
+                                                tracked[a].car, tracked[a].cost});
+    }
+    // Restoring marked every car; only the ones changed before the snapshot still are
+    for (uint32_t i = 0; i < header->carCount; i++) redispatchDirty[i] = cars[i].redispatchDirty;
+    LOG_INFO("Restored " << header->carCount << " cars and " << header->eventCount << " events at t="
+             << header->time << "ms");
+    return true;
+}
+
+bool ElevatorManager::saveSnapshot(const string& path) {
+    vector<char> image;
+    writeSnapshot(image);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+    return fclose(file) == 0 && written;
+}
+
+bool ElevatorManager::loadSnapshot(const string& path) {
+    MappedFile file;
+    return file.open(path, sizeof(SnapshotHeader)) && restoreSnapshot(file.bytes(), file.size());
+}
+
+// Records board/alight times per trace passenger; each slot is written by one car only
+class TripRecorder : public TripObserver {
+private:
+    vector<SimTime> boarded;
+    vector<SimTime> alighted;
+
+public:
+    explicit TripRecorder(size_t passengers) : boarded(passengers, -1), alighted(passengers, -1) {}
+
+    // Riders evacuated from a failed car board again; their wait ended the first time
+    void onBoard(int passenger, int, int, SimTime time) override {
+        SimTime& first = boarded[static_cast<size_t>(passenger)];
+        if (first < 0) first = time;
+    }
+
+    void onAlight(int passenger, int, int, SimTime time) override {
+        alighted[static_cast<size_t>(passenger)] = time;
+    }
+
+    SimTime getBoarded(size_t passenger) const { return boarded[passenger]; }
+    SimTime getAlighted(size_t passenger) const { return alighted[passenger]; }
+};
+
+struct LatencySummary {
+    double mean;
+    SimTime p95;
+    SimTime p99;
+};
+
+// Nearest-rank percentiles; sorts `samples`
+LatencySummary summarize(vector<SimTime>& samples) {
+    LatencySummary summary{0.0, 0, 0};
+    if (samples.empty()) return summary;
+    sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (SimTime sample : samples) total += static_cast<double>(sample);
+    summary.mean = total / static_cast<double>(samples.size());
+    auto rank = [&](double q) {
+        size_t index = static_cast<size_t>(ceil(q * static_cast<double>(samples.size())));
+        return samples[min(samples.size(), max<size_t>(1, index)) - 1];
+    };
+    summary.p95 = rank(0.95);
+    summary.p99 = rank(0.99);
+    return summary;
+}
+
+struct ReplayReport {
+    size_t calls;
+    size_t completed;
+    double wallSeconds;
+    LatencySummary wait;      // Call to boarding, ms
+    LatencySummary journey;   // Call to alighting, ms
+    long long floorsTravelled;
+    SimTime finishedAt;
+};
+
+struct ReplayOptions {
+    int cars = 4;
+    int capacity = 0;            // Persons per car, 0 for unlimited
+    string parking;              // makeParkingStrategy name, empty for none
+    SimTime redispatch = 0;      // Re-dispatch interval, 0 for off
+    SimTime window = 0;          // Dispatch cycle length; 0 assigns each call on arrival
+    int failures = 0;            // Cars taken out of service during the run
+    SimTime failAt = -1;         // When they fail; -1 for halfway through the trace
+};
+
+// Feeds the trace to a fresh manager as destination calls at their timestamps and
+// runs until every car is idle. With a window, the calls of each cycle are collected
+// and assigned as one batch at its end.
+ReplayReport replayTrace(const vector<TraceCall>& trace, unique_ptr<ElevatorSelectionStrategy> strategy,
+                         const ReplayOptions& options) {
+    const int cars = options.cars;
+    ElevatorManager manager;
+    manager.setRedispatchInterval(options.redispatch);
+    manager.setSelectionStrategy(std::move(strategy));
+    manager.setParkingStrategy(makeParkingStrategy(options.parking));
+    manager.createElevators(cars);
+    for (int i = 0; i < cars; i++) manager.getElevator(ElevatorHandle{i}).setCapacity(options.capacity);
+    TripRecorder trips(trace.size());
+    manager.setTripObserver(&trips);
+
+    // The first `failures` cars fail together once the clock reaches failAt
+    const SimTime failAt = options.failAt >= 0 ? options.failAt : (trace.empty() ? 0 : trace.back().time / 2);
+    bool failed = options.failures <= 0;
+    auto failIfDue = [&](SimTime until) {
+        if (failed || until < failAt) return;
+        failed = true;
+        manager.runUntil(failAt);
+        vector<ElevatorHandle> broken;
+        for (int i = 0; i < min(options.failures, cars - 1); i++) broken.push_back(ElevatorHandle{i});
+        manager.takeOutOfService(broken.data(), broken.size());
+    };
+
+    auto started = chrono::steady_clock::now();
+    vector<HallCall> cycle;
+    vector<int> cyclePassengers;
+    for (size_t i = 0; i < trace.size();) {
+        if (options.window <= 0) {
+            failIfDue(trace[i].time);
+            manager.runUntil(trace[i].time);
+            manager.addDestinationCall(trace[i].sourceFloor, trace[i].destinationFloor, static_cast<int>(i));
+            i++;
+            continue;
+        }
+        SimTime cycleEnd = (trace[i].time / options.window + 1) * options.window;
+        cycle.clear();
+        cyclePassengers.clear();
+        for (; i < trace.size() && trace[i].time < cycleEnd; i++) {
+            const TraceCall& call = trace[i];
+            Direction direction = call.destinationFloor > call.sourceFloor ? Direction::UP : Direction::DOWN;
+            cycle.push_back(HallCall{call.sourceFloor, direction, call.destinationFloor});
+            cyclePassengers.push_back(static_cast<int>(i));
+        }
+        failIfDue(cycleEnd);
+        manager.runUntil(cycleEnd);
+        manager.addDestinationCallBatch(cycle.data(), cycle.size(), cyclePassengers.data());
+    }
+    failIfDue(LLONG_MAX);
+    manager.run();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+
+    ReplayReport report{trace.size(), 0, elapsed.count(), {0.0, 0, 0}, {0.0, 0, 0}, 0, manager.getTime()};
+    vector<SimTime> waits;
+    vector<SimTime> journeys;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (trips.getAlighted(i) < 0) continue;
+        report.completed++;
+        waits.push_back(trips.getBoarded(i) - trace[i].time);
+        journeys.push_back(trips.getAlighted(i) - trace[i].time);
+    }
+    report.wait = summarize(waits);
+    report.journey = summarize(journeys);
+    for (int i = 0; i < cars; i++) {
+        report.floorsTravelled += manager.getElevator(ElevatorHandle{i}).getFloorsTravelled();
+    }
+    return report;
+}
+
+void printReplayReport(const string& strategy, const ReplayReport& report) {
+    printf("%-12s %10.0f calls/s  wait mean/p95/p99 %6.1f/%6.1f/%6.1f s  "
+           "journey %6.1f/%6.1f/%6.1f s  floors %lld  served %zu/%zu\n",
+           strategy.c_str(), report.wallSeconds > 0 ? report.calls / report.wallSeconds : 0.0,
+           report.wait.mean / 1000.0, report.wait.p95 / 1000.0, report.wait.p99 / 1000.0,
+           report.journey.mean / 1000.0, report.journey.p95 / 1000.0, report.journey.p99 / 1000.0,
+           report.floorsTravelled, report.completed, report.calls);
+}
+
+// --replay PROFILE|FILE [--strategy NAME] [--cars N] [--capacity N] [--parking NAME]
+//          [--redispatch MS] [--window MS] [--fail N] [--fail-at MS] [--floors N] [--calls N]
+//          [--gap MS] [--seed N]
+int runReplayBenchmark(const string& source, const string& strategyName, const ReplayOptions& options,
+                       int floors, size_t calls, SimTime meanGap, unsigned seed) {
+    if (!isParkingName(options.parking)) {
+        cerr << "Unknown parking policy: " << options.parking << "\n";
+        return 1;
+    }
+    floors = min(max(floors, 2), MAX_FLOORS - 1);
+    vector<TraceCall> trace;
+    TrafficProfile profile;
+    if (parseTrafficProfile(source, profile)) {
+        trace = generateTrace(profile, floors, calls, meanGap, seed);
+    } else if (!loadTraceFromEventLog(source, trace) && !loadTrace(source, trace)) {
+        cerr << "Unknown traffic profile or unreadable trace: " << source << "\n";
+        return 1;
+    }
+
+    vector<string> strategies;
+    if (strategyName.empty()) {
+        strategies = {"nearest", "vectorized", "destination", "eta", "load"};
+        if (options.window > 0) strategies.push_back("batch");  // Without cycles it only repeats eta
+    } else {
+        strategies.push_back(strategyName);
+    }
+
+    Logger::setLevel(LogLevel::OFF);
+    cout << "Replaying " << trace.size() << " calls (" << source << ") on " << options.cars << " cars";
+    if (options.capacity > 0) cout << " of " << options.capacity << " persons";
+    if (makeParkingStrategy(options.parking)) cout << ", " << options.parking << " parking";
+    if (options.redispatch > 0) cout << ", re-dispatch every " << options.redispatch << " ms";
+    if (options.window > 0) cout << ", " << options.window << " ms dispatch cycles";
+    if (options.failures > 0) {
+        cout << ", " << min(options.failures, options.cars - 1) << " out of service at ";
+        if (options.failAt >= 0) cout << "t=" << options.failAt << "ms";
+        else cout << "halfway";
+    }
+    cout << "\n";
+    int status = 0;
+    for (const string& name : strategies) {
+        unique_ptr<ElevatorSelectionStrategy> strategy = makeSelectionStrategy(name);
+        if (!strategy) {
+            cerr << "Unknown strategy: " << name << "\n";
+            status = 1;
+            continue;
+        }
+        printReplayReport(name, replayTrace(trace, std::move(strategy), options));
+    }
+    return status;
+}
+
+// Monte Carlo Strategy Comparison
+
+struct MonteCarloConfig {
+    string strategy;
+    int cars;
+    int capacity;   // Persons per car, 0 for unlimited
+};
+
+// Welford accumulator for the spread of a metric across runs
+struct RunningStat {
+    size_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value) {
+        count++;
+        double delta = value - mean;
+        mean += delta / static_cast<double>(count);
+        m2 += delta * (value - mean);
+    }
+
+    double stddev() const { return count > 1 ? sqrt(m2 / static_cast<double>(count - 1)) : 0.0; }
+};
+
+struct MonteCarloSummary {
+    MonteCarloConfig config;
+    RunningStat waitMean;       // Seconds
+    RunningStat waitP95;
+    RunningStat journeyMean;
+    RunningStat floorsTravelled;
+    size_t unserved = 0;
+};
+
+// Runs every config against `runs` traces on a work-stealing pool. Run r replays the
+// trace seeded with baseSeed + r for every config, so configs are compared on the same
+// traffic. Each task builds its own ElevatorManager and shares nothing but read-only
+// inputs, and results are folded in task order, so a seed always gives the same table.
+vector<MonteCarloSummary> runMonteCarlo(const vector<MonteCarloConfig>& configs, TrafficProfile profile,
+                                        int floors, size_t calls, SimTime meanGap, unsigned baseSeed,
+                                        size_t runs, size_t workers) {
+    vector<ReplayReport> reports(configs.size() * runs);
+    WorkStealingPool pool(workers);
+    pool.runAll(reports.size(), [&](size_t task) {
+        size_t run = task / configs.size();
+        const MonteCarloConfig& config = configs[task % configs.size()];
+        vector<TraceCall> trace = generateTrace(profile, floors, calls, meanGap, baseSeed + static_cast<unsigned>(run));
+        ReplayOptions options;
+        options.cars = config.cars;
+        options.capacity = config.capacity;
+        reports[task] = replayTrace(trace, makeSelectionStrategy(config.strategy), options);
+    });
+
+    vector<MonteCarloSummary> summaries(configs.size());
+    for (size_t c = 0; c < configs.size(); c++) summaries[c].config = configs[c];
+    for (size_t task = 0; task < reports.size(); task++) {
+        const ReplayReport& report = reports[task];
+        MonteCarloSummary& summary = summaries[task % configs.size()];
+        summary.waitMean.add(report.wait.mean / 1000.0);
+        summary.waitP95.add(static_cast<double>(report.wait.p95) / 1000.0);
+        summary.journeyMean.add(report.journey.mean / 1000.0);
+        summary.floorsTravelled.add(static_cast<double>(report.floorsTravelled));
+        summary.unserved += report.calls - report.completed;
+    }
+    return summaries;
+}
+
+vector<int> parseIntList(const string& text) {
+    vector<int> values;
+    istringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        if (!item.empty()) values.push_back(atoi(item.c_str()));
+    }
+    return values;
+}
+
+// --monte-carlo RUNS [--profile NAME] [--strategy NAME] [--cars N | --cars-list A,B,..]
+//                    [--capacity N] [--floors N] [--calls N] [--gap MS] [--seed BASE] [--workers N]
+int runMonteCarloMode(size_t runs, const string& profileName, const string& strategyName,
+                      const vector<int>& carCounts, int capacity, int floors, size_t calls, SimTime meanGap,
+                      unsigned seed, size_t workers) {
+    TrafficProfile profile;
+    if (!parseTrafficProfile(profileName, profile)) {
+        cerr << "Unknown traffic profile: " << profileName << "\n";
+        return 1;
+    }
+    vector<string> strategies;
+    if (strategyName.empty()) strategies = {"nearest", "destination", "eta"};
+    else strategies.push_back(strategyName);
+    for (const string& name : strategies) {
+        if (!makeSelectionStrategy(name)) {
+            cerr << "Unknown strategy: " << name << "\n";
+            return 1;
+        }
+    }
+
+    vector<MonteCarloConfig> configs;
+    for (int cars : carCounts) {
+        for (const string& name : strategies) configs.push_back(MonteCarloConfig{name, max(cars, 1), capacity});
+    }
+    floors = min(max(floors, 2), MAX_FLOORS - 1);
+    if (workers == 0) workers = max<size_t>(1, thread::hardware_concurrency());
+
+    Logger::setLevel(LogLevel::OFF);
+    auto started = chrono::steady_clock::now();
+    vector<MonteCarloSummary> summaries =
+        runMonteCarlo(configs, profile, floors, calls, meanGap, seed, runs, workers);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+
+    printf("%zu runs x %zu configs, %s, %d floors, %zu calls per run, %zu workers, %.2f s\n",
+           runs, configs.size(), profileName.c_str(), floors, calls, workers, elapsed.count());
+    printf("%-12s %4s  %16s  %16s  %16s  %18s  %8s\n", "strategy", "cars", "wait mean (s)",
+           "wait p95 (s)", "journey mean (s)", "floors travelled", "unserved");
+    for (const MonteCarloSummary& summary : summaries) {
+        printf("%-12s %4d  %7.2f +- %6.2f  %7.2f +- %6.2f  %7.2f +- %6.2f  %8.0f +- %7.0f  %8zu\n",
+               summary.config.strategy.c_str(), summary.config.cars,
+               summary.waitMean.mean, summary.waitMean.stddev(),
+               summary.waitP95.mean, summary.waitP95.stddev(),
+               summary.journeyMean.mean, summary.journeyMean.stddev(),
+               summary.floorsTravelled.mean, summary.floorsTravelled.stddev(), summary.unserved);
+    }
+    return 0;
+}
+
+// --read-log FILE: one streaming pass over a mapped event log
+int summarizeEventLog(const string& path) {
+    MappedEventLog log;
+    if (!log.open(path)) {
+        cerr << "Not a readable event log: " << path << "\n";
+        return 1;
+    }
+    static const char* const kindNames[LOG_RECORD_KINDS] = {
+        "hall calls", "destination calls", "stops added", "state changes",
+        "floor arrivals", "door openings", "door closings", "car calls"};
+    array<uint64_t, LOG_RECORD_KINDS> counts{};
+    map<int, uint64_t> floorsByCar;
+    SimTime first = LLONG_MAX;
+    SimTime last = 0;
+    for (const LogRecord& record : log) {
+        size_t kind = static_cast<size_t>(record.kind);
+        if (kind < counts.size()) counts[kind]++;
+        if (record.kind == LogRecordKind::FLOOR_ARRIVAL) floorsByCar[record.car]++;
+        first = min<SimTime>(first, record.time);
+        last = max<SimTime>(last, record.time);
+    }
+    cout << path << ": " << log.size() << " records";
+    if (log.size() > 0) cout << ", t=" << first << "ms to t=" << last << "ms";
+    cout << "\n";
+    for (size_t kind = 0; kind < counts.size(); kind++) {
+        printf("  %-18s %12llu\n", kindNames[kind], static_cast<unsigned long long>(counts[kind]));
+    }
+    for (const auto& car : floorsByCar) {
+        printf("  elevator %-9d %12llu floors\n", car.first, static_cast<unsigned long long>(car.second));
+    }
+    return 0;
+}
+
+// --serve PORT [--duration S]: live intake, simulated time tracking the wall clock
+int runIntakeServer(uint16_t port, double durationSeconds, int cars) {
+    ElevatorManager manager;
+    manager.createElevators(cars);
+    HallCallServer server(manager);
+    if (!server.listen(port)) {
+        cerr << "Cannot listen on port " << port << "\n";
+        return 1;
+    }
+    server.start();
+    auto started = chrono::steady_clock::now();
+    while (true) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+        if (durationSeconds > 0 && elapsed.count() >= durationSeconds) break;
+        manager.runUntil(static_cast<SimTime>(elapsed.count() * 1000.0));
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    server.stop();
+    manager.runUntil(manager.getTime());
+    cout << "Accepted " << server.getCallsAccepted() << " calls in " << server.getFramesDecoded()
+         << " frames, " << server.getStalls() << " backpressure stalls, "
+         << server.getProtocolErrors() << " protocol errors\n";
+    return 0;
+}
+
+// --push PORT [--calls N] [--floors N] [--seed N]: sends a synthetic trace as
+// destination-call frames as fast as the server accepts them
+int runIntakeClient(uint16_t port, size_t calls, int floors, unsigned seed) {
+    vector<TraceCall> trace =
+        generateTrace(TrafficProfile::POISSON, min(max(floors, 2), MAX_FLOORS - 1), calls, 1, seed);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&server), sizeof(server)) != 0) {
+        cerr << "Cannot connect to port " << port << "\n";
+        if (fd >= 0) ::close(fd);
+        return 1;
+    }
+
+    const size_t framePayload = 256;
+    vector<char> frame;
+    auto started = chrono::steady_clock::now();
+    for (size_t first = 0; first < trace.size(); first += framePayload) {
+        size_t count = min(framePayload, trace.size() - first);
+        frame.resize(HallCallFrameHeader::SIZE + count * HallCallWire::SIZE);
+        HallCallFrameHeader{static_cast<uint16_t>(count), 0}.write(frame.data());
+        for (size_t i = first; i < first + count; i++) {
+            HallCallWire call{static_cast<int16_t>(trace[i].sourceFloor), static_cast<int16_t>(trace[i].destinationFloor),
+                              static_cast<uint8_t>(trace[i].destinationFloor > trace[i].sourceFloor ? Direction::UP
+                                                                                                     : Direction::DOWN)};
+            call.write(frame.data() + HallCallFrameHeader::SIZE + (i - first) * HallCallWire::SIZE);
+        }
+        for (size_t sent = 0; sent < frame.size();) {
+            ssize_t written = send(fd, frame.data() + sent, frame.size() - sent, 0);
+            if (written <= 0) {
+                cerr << "Connection lost after " << first << " calls\n";
+                ::close(fd);
+                return 1;
+            }
+            sent += static_cast<size_t>(written);
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+    ::close(fd);
+    cout << "Sent " << trace.size() << " calls in " << elapsed.count() << " s ("
+         << static_cast<double>(trace.size()) / max(elapsed.count(), 1e-9) << " calls/s)\n";
+    return 0;
+}
+
+// Microbenchmarks
+
+// Keeps a benchmarked result alive without the compiler proving it unused
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+struct MicrobenchResult {
+    string name;
+    size_t iterations;
+    double nsPerIteration;
+};
+
+// Calls body(iterations) with a doubling iteration count until one run takes at
+// least minSeconds, then reports the time per iteration of that run
+template <typename Body>
+MicrobenchResult runMicrobench(const string& name, Body body, double minSeconds = 0.2) {
+    size_t iterations = 1;
+    while (true) {
+        auto started = chrono::steady_clock::now();
+        body(iterations);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - started;
+        if (elapsed.count() >= minSeconds || iterations >= (size_t(1) << 40)) {
+            return MicrobenchResult{name, iterations, elapsed.count() * 1e9 / static_cast<double>(iterations)};
+        }
+        iterations *= 2;
+    }
+}
+
+// Spreads the cars over the building in a mix of idle and moving states
+void scatterFleet(ElevatorManager& manager, int cars, int floors, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> floor(1, floors);
+    manager.createElevators(cars);
+    for (int i = 0; i < cars; i++) {
+        manager.getElevator(ElevatorHandle{i}).addToQueue(floor(rng));
+    }
+    manager.runUntil(FLOOR_TRAVEL_TIME * floors / 2);
+}
+
+class CountingObserver : public ElevatorObserver {
+public:
+    size_t updates = 0;
+    void update(int, StateType) override { updates++; }
+};
+
+vector<MicrobenchResult> runMicrobenchmarks() {
+    const int floors = 60;
+    vector<MicrobenchResult> results;
+    Logger::setLevel(LogLevel::OFF);
+
+    for (int cars : {4, 16, 64, 256}) {
+        ElevatorManager manager;
+        scatterFleet(manager, cars, floors, 7);
+        vector<Elevator*> elevators;
+        for (int i = 0; i < cars; i++) elevators.push_back(&manager.getElevator(ElevatorHandle{i}));
+        NearestElevatorStrategy nearest;
+        VectorizedNearestStrategy vectorized;
+        EtaCostStrategy eta;
+        const FleetView& fleet = manager.getFleetView();
+        string suffix = "/" + to_string(cars);
+
+        results.push_back(runMicrobench("NearestElevatorStrategy::selectElevator" + suffix, [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Direction direction = (i & 1) ? Direction::UP : Direction::DOWN;
+                doNotOptimize(nearest.selectElevator(static_cast<int>(i % floors) + 1, direction, elevators));
+            }
+        }));
+        results.push_back(runMicrobench("NearestElevatorStrategy::selectElevatorIndex" + suffix, [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Direction direction = (i & 1) ? Direction::UP : Direction::DOWN;
+                doNotOptimize(nearest.selectElevatorIndex(static_cast<int>(i % floors) + 1, direction, fleet, elevators));
+            }
+        }));
+        results.push_back(runMicrobench(string("VectorizedNearestStrategy(") + vectorized.getKernelName() + ")" + suffix,
+                                        [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Direction direction = (i & 1) ? Direction::UP : Direction::DOWN;
+                doNotOptimize(vectorized.selectElevatorIndex(static_cast<int>(i % floors) + 1, direction, fleet, elevators));
+            }
+        }));
+        results.push_back(runMicrobench("EtaCostStrategy::selectElevatorIndex" + suffix, [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Direction direction = (i & 1) ? Direction::UP : Direction::DOWN;
+                doNotOptimize(eta.selectElevatorIndex(static_cast<int>(i % floors) + 1, direction, fleet, elevators));
+            }
+        }));
+    }
+
+    {
+        ElevatorManager manager;
+        manager.createElevators(1);
+        Elevator& car = manager.getElevator(ElevatorHandle{0});
+        results.push_back(runMicrobench("Elevator::setState", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                car.setState((i & 1) ? StateType::MOVING_UP : StateType::IDLE);
+            }
+            doNotOptimize(car.getStateType());
+        }));
+    }
+
+    {
+        // One hall call per iteration; the queued trips are simulated in chunks
+        ElevatorManager manager;
+        manager.createElevators(8);
+        results.push_back(runMicrobench("ElevatorManager::addToQueue+processQueue", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                manager.addToQueue(static_cast<int>((i * 7) % floors) + 1, (i & 1) ? Direction::UP : Direction::DOWN);
+                if ((i & 63) == 63) manager.run();
+            }
+            manager.run();
+        }));
+    }
+
+    {
+        // A car with eight hall stops fails and its calls move to the other 255 in one
+        // pass; it comes back at once so every iteration starts from the same fleet
+        ElevatorManager manager;
+        manager.createElevators(256);
+        results.push_back(runMicrobench("ElevatorManager::takeOutOfService/256x8", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                ElevatorHandle car{static_cast<int>(i % 256)};
+                Elevator& elevator = manager.getElevator(car);
+                for (int stop = 0; stop < 8; stop++) elevator.addToQueue(static_cast<int>((i + stop * 13) % floors) + 1);
+                manager.takeOutOfService(car);
+                manager.returnToService(car);
+                if ((i & 255) == 255) manager.run();
+            }
+            manager.run();
+        }));
+    }
+
+    {
+        // Same workload on the compile-time configuration
+        ElevatorSystem<61, 8> system;
+        results.push_back(runMicrobench("ElevatorSystem<61,8>::addToQueue+processQueue", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                system.addToQueue(static_cast<int>((i * 7) % floors) + 1, (i & 1) ? Direction::UP : Direction::DOWN);
+                if ((i & 63) == 63) system.run();
+            }
+            system.run();
+        }));
+    }
+
+    {
+        ElevatorSystem<61, 64> system;
+        mt19937 rng(7);
+        uniform_int_distribution<int> floor(1, floors);
+        for (int car = 0; car < 64; car++) system.addStop(car, floor(rng));
+        system.runUntil(FLOOR_TRAVEL_TIME * floors / 2);
+        results.push_back(runMicrobench("NearestCarPolicy::select/64", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Direction direction = (i & 1) ? Direction::UP : Direction::DOWN;
+                doNotOptimize(NearestCarPolicy::select(static_cast<int>(i % floors) + 1, direction, system.getFleet()));
+            }
+        }));
+    }
+
+    for (size_t batchSize : {8, 32}) {
+        // One dispatch cycle of scattered hall calls on 16 cars, solved to optimality
+        ElevatorManager manager;
+        scatterFleet(manager, 16, floors, 7);
+        vector<Elevator*> elevators;
+        for (int i = 0; i < 16; i++) elevators.push_back(&manager.getElevator(ElevatorHandle{i}));
+        vector<HallCall> calls;
+        for (size_t c = 0; c < batchSize; c++) {
+            int floor = static_cast<int>((c * 13) % floors) + 1;
+            calls.push_back(HallCall{floor, (c & 1) ? Direction::UP : Direction::DOWN});
+        }
+        BatchAssignmentStrategy batch(chrono::microseconds(1000000));
+        vector<int> assignments(batchSize);
+        results.push_back(runMicrobench("BatchAssignmentStrategy::selectElevatorBatch/" + to_string(batchSize) + "x16",
+                                        [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                batch.selectElevatorBatch(calls.data(), calls.size(), manager.getFleetView(), elevators, assignments.data());
+            }
+            doNotOptimize(assignments[0]);
+        }));
+    }
+
+    for (int observerCount : {1, 16, 64}) {
+        ElevatorManager manager;
+        manager.createElevators(1);
+        Elevator& car = manager.getElevator(ElevatorHandle{0});
+        vector<CountingObserver> observers(static_cast<size_t>(observerCount));
+        for (CountingObserver& observer : observers) manager.subscribeToCar(&observer, 0);
+        results.push_back(runMicrobench("ElevatorManager::flushNotifications/" + to_string(observerCount),
+                                        [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                car.setState((i & 1) ? StateType::MOVING_UP : StateType::IDLE);
+                manager.flushNotifications();
+            }
+            doNotOptimize(observers[0].updates);
+        }));
+    }
+    return results;
+}
+
+// Layout follows Google Benchmark's JSON output so existing tooling can diff runs
+void writeMicrobenchJson(ostream& out, const vector<MicrobenchResult>& results) {
+    out << "{\n  \"context\": {\n"
+        << "    \"executable\": \"main\",\n"
+        << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+        << "    \"nearest_car_kernel\": \"" << detectNearestCarKernel().name << "\",\n"
+        << "    \"max_floors\": " << MAX_FLOORS << "\n"
+        << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicrobenchResult& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\", \"run_type\": \"iteration\", "
+            << "\"iterations\": " << result.iterations << ", "
+            << "\"real_time\": " << result.nsPerIteration << ", \"time_unit\": \"ns\"}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// --microbench [--json FILE]: a table on stdout, plus JSON when a file is given
+int runMicrobenchmarkSuite(const string& jsonPath) {
+    vector<MicrobenchResult> results = runMicrobenchmarks();
+    for (const MicrobenchResult& result : results) {
+        printf("%-56s %12.1f ns %14zu iterations\n", result.name.c_str(), result.nsPerIteration, result.iterations);
+    }
+    if (jsonPath.empty()) return 0;
+    ofstream out(jsonPath);
+    if (!out) {
+        cerr << "Cannot write " << jsonPath << "\n";
+        return 1;
+    }
+    writeMicrobenchJson(out, results);
+    return 0;
+}
+
+// --resume FILE [--workers N]: warm start from a --save-snapshot file and run it out
+int resumeFromSnapshot(const string& path, size_t workers) {
+    ElevatorManager manager;
+    auto started = chrono::steady_clock::now();
+    if (!manager.loadSnapshot(path)) {
+        cerr << "Cannot restore " << path << "\n";
+        return 1;
+    }
+    chrono::duration<double, micro> restored = chrono::steady_clock::now() - started;
+    const FleetView& fleet = manager.getFleetView();
+    cout << "Restored " << fleet.size() << " cars at t=" << manager.getTime() << "ms in "
+         << static_cast<long long>(restored.count()) << " us\n";
+
+    if (workers > 0) manager.runParallel(workers);
+    else manager.run();
+    long long floors = 0;
+    for (size_t i = 0; i < fleet.size(); i++) {
+        floors += manager.getElevator(ElevatorHandle{static_cast<int>(i)}).getFloorsTravelled();
+    }
+    cout << "Finished at t=" << manager.getTime() << "ms, " << floors << " floors travelled\n";
+    return 0;
+}
+
+// Self-Test
+// Round-trip and equivalence checks over the on-disk formats and the simulators,
+// run by --self-test. Each check prints one line; any failure makes the exit status 1.
+
+struct SelfTestResult {
+    string name;
+    bool passed;
+    string detail;  // Why it failed, empty on success
+};
+
+// A named temporary file, removed when it goes out of scope
+class ScratchFile {
+private:
+    string path;
+
+public:
+    ScratchFile() {
+        char name[] = "/tmp/elevator-self-test-XXXXXX";
+        int fd = mkstemp(name);
+        if (fd < 0) return;
+        ::close(fd);
+        path = name;
+    }
+    ~ScratchFile() {
+        if (!path.empty()) unlink(path.c_str());
+    }
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator=(const ScratchFile&) = delete;
+
+    const string& getPath() const { return path; }
+};
+
+SelfTestResult selfTestFailure(const string& name, const string& detail) {
+    return SelfTestResult{name, false, detail};
+}
+
+// Records a run with every kind of call, maps the log back and recovers the trace
+SelfTestResult checkEventLogRoundTrip() {
+    const string name = "event log round trip";
+    ScratchFile scratch;
+    EventLogWriter writer;
+    if (scratch.getPath().empty() || !writer.open(scratch.getPath())) {
+        return selfTestFailure(name, "cannot create a scratch file");
+    }
+    vector<TraceCall> trace = generateTrace(TrafficProfile::LUNCH, 20, 300, 2000, 7);
+    ElevatorManager manager;
+    manager.setEventLog(&writer);
+    manager.createElevators(4);
+    for (size_t i = 0; i < trace.size(); i++) {
+        manager.runUntil(trace[i].time);
+        manager.addDestinationCall(trace[i].sourceFloor, trace[i].destinationFloor);
+        if (i % 25 == 0) manager.addToQueue(trace[i].destinationFloor, Direction::DOWN);
+        if (i % 40 == 0) manager.addCarCall(static_cast<int>(i % 4), trace[i].sourceFloor);
+    }
+    manager.run();
+    manager.setEventLog(nullptr);
+    if (!writer.close()) return selfTestFailure(name, "cannot write the log");
+
+    MappedEventLog log;
+    if (!log.open(scratch.getPath())) return selfTestFailure(name, "cannot map the log");
+    if (log.size() != writer.getRecordCount()) {
+        return selfTestFailure(name, to_string(writer.getRecordCount()) + " records written, " +
+                                     to_string(log.size()) + " mapped");
+    }
+    array<size_t, LOG_RECORD_KINDS> kinds{};
+    SimTime previous = 0;
+    for (const LogRecord& record : log) {
+        if (static_cast<size_t>(record.kind) >= kinds.size()) return selfTestFailure(name, "unknown record kind");
+        if (record.time < previous) return selfTestFailure(name, "records out of time order");
+        kinds[static_cast<size_t>(record.kind)]++;
+        previous = record.time;
+    }
+    for (size_t kind = 0; kind < kinds.size(); kind++) {
+        if (kinds[kind] == 0) return selfTestFailure(name, "no records of kind " + to_string(kind));
+    }
+
+    vector<TraceCall> loaded;
+    if (!loadTraceFromEventLog(scratch.getPath(), loaded)) return selfTestFailure(name, "cannot reload the trace");
+    if (loaded.size() != trace.size()) {
+        return selfTestFailure(name, to_string(trace.size()) + " calls recorded, " + to_string(loaded.size()) +
+                                     " recovered");
+    }
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (loaded[i].time != trace[i].time || loaded[i].sourceFloor != trace[i].sourceFloor ||
+            loaded[i].destinationFloor != trace[i].destinationFloor) {
+            return selfTestFailure(name, "call " + to_string(i) + " differs after the round trip");
+        }
+    }
+
+    // A foreign file must be refused rather than read as records
+    FILE* file = fopen(scratch.getPath().c_str(), "r+b");
+    if (!file || fputc('X', file) == EOF || fclose(file) != 0) return selfTestFailure(name, "cannot corrupt the log");
+    if (log.open(scratch.getPath())) return selfTestFailure(name, "accepted a log with a bad magic");
+    return SelfTestResult{name, true, ""};
+}
+
+// Drives ElevatorSystem and a default ElevatorManager with the same random hall and
+// car calls; the cars must stand at the same floors at every call and at the end
+SelfTestResult checkElevatorSystemEquivalence() {
+    const string name = "ElevatorSystem matches the manager";
+    const int floors = 40;
+    const int cars = 6;
+    for (unsigned seed = 1; seed <= 200; seed++) {
+        mt19937 rng(seed);
+        uniform_int_distribution<int> floor(0, floors - 1);
+        uniform_int_distribution<int> car(0, cars - 1);
+        uniform_int_distribution<SimTime> gap(0, 4 * FLOOR_TRAVEL_TIME);
+        ElevatorSystem<floors, cars> system;
+        ElevatorManager manager;
+        manager.createElevators(cars);
+        string where = "seed " + to_string(seed);
+
+        auto compare = [&](const char* when) {
+            if (system.getTime() != manager.getTime()) return where + ": clocks differ " + when;
+            for (int c = 0; c < cars; c++) {
+                const Elevator& elevator = manager.getElevator(ElevatorHandle{c});
+                if (system.getCurrentFloor(c) != elevator.getCurrentFloor() ||
+                    system.getFloorsTravelled(c) != elevator.getFloorsTravelled()) {
+                    return where + ": car " + to_string(c) + " differs " + when;
+                }
+            }
+            return string();
+        };
+
+        SimTime time = 0;
+        for (int call = 0; call < 60; call++) {
+            time += gap(rng);
+            system.runUntil(time);
+            manager.runUntil(time);
+            string mismatch = compare(("before call " + to_string(call)).c_str());
+            if (!mismatch.empty()) return selfTestFailure(name, mismatch);
+            if (rng() % 3 == 0) {
+                int target = car(rng);
+                int stop = floor(rng);
+                system.addStop(target, stop);
+                manager.addCarCall(target, stop);
+            } else {
+                int hall = floor(rng);
+                Direction direction = rng() % 2 == 0 ? Direction::UP : Direction::DOWN;
+                system.addToQueue(hall, direction);
+                manager.addToQueue(hall, direction);
+            }
+        }
+        system.run();
+        manager.run();
+        string mismatch = compare("at the end");
+        if (!mismatch.empty()) return selfTestFailure(name, mismatch);
+    }
+    return SelfTestResult{name, true, ""};
+}
+
+// Snapshots a run halfway through each seeded trace, restores it from a file into a
+// fresh manager and feeds both the rest of the trace; they must finish identically.
+// Most seeds re-dispatch; parking is left off, its bookkeeping is not part of the image.
+SelfTestResult checkSnapshotRoundTrip() {
+    const string name = "snapshot round trip";
+    const char* strategies[] = {"nearest", "vectorized", "destination", "eta", "load", "batch"};
+    const int cars = 4;
+    ScratchFile scratch;
+    if (scratch.getPath().empty()) return selfTestFailure(name, "cannot create a scratch file");
+    vector<char> image;
+    for (unsigned seed = 1; seed <= 48; seed++) {
+        const char* strategy = strategies[seed % 6];
+        string where = "seed " + to_string(seed) + " (" + strategy + ")";
+        vector<TraceCall> trace = generateTrace(TrafficProfile::POISSON, 30, 200, 2500, seed);
+        const size_t half = trace.size() / 2;
+
+        ElevatorManager original;
+        original.setSelectionStrategy(makeSelectionStrategy(strategy));
+        original.createElevators(cars);
+        for (int i = 0; i < cars; i++) original.getElevator(ElevatorHandle{i}).setCapacity(seed % 2 == 0 ? 4 : 0);
+        if (seed % 3 != 2) original.setRedispatchInterval(2000);
+        TripRecorder originalTrips(trace.size());
+        original.setTripObserver(&originalTrips);
+        for (size_t i = 0; i < half; i++) {
+            original.runUntil(trace[i].time);
+            original.addDestinationCall(trace[i].sourceFloor, trace[i].destinationFloor, static_cast<int>(i));
+        }
+        original.runUntil(trace[half].time - 1);
+        const SimTime snapshotAt = original.getTime();
+        const unsigned long long redispatchedBefore = original.getRedispatchCount();
+        if (image.empty() && original.getPendingAssignmentCount() > 0) original.writeSnapshot(image);
+        if (!original.saveSnapshot(scratch.getPath())) return selfTestFailure(name, where + ": cannot save");
+
+        ElevatorManager restored;
+        if (!restored.loadSnapshot(scratch.getPath())) return selfTestFailure(name, where + ": cannot restore");
+        if (restored.getTime() != snapshotAt || restored.getFleetView().size() != static_cast<size_t>(cars) ||
+            restored.getPendingAssignmentCount() != original.getPendingAssignmentCount()) {
+            return selfTestFailure(name, where + ": restored a different fleet");
+        }
+        TripRecorder restoredTrips(trace.size());
+        restored.setTripObserver(&restoredTrips);
+
+        for (size_t i = half; i < trace.size(); i++) {
+            original.runUntil(trace[i].time);
+            restored.runUntil(trace[i].time);
+            original.addDestinationCall(trace[i].sourceFloor, trace[i].destinationFloor, static_cast<int>(i));
+            restored.addDestinationCall(trace[i].sourceFloor, trace[i].destinationFloor, static_cast<int>(i));
+        }
+        original.run();
+        restored.run();
+
+        if (original.getTime() != restored.getTime()) return selfTestFailure(name, where + ": finish times differ");
+        if (original.getRedispatchCount() - redispatchedBefore != restored.getRedispatchCount()) {
+            return selfTestFailure(name, where + ": re-dispatched differently");
+        }
+        for (int c = 0; c < cars; c++) {
+            const Elevator& a = original.getElevator(ElevatorHandle{c});
+            const Elevator& b = restored.getElevator(ElevatorHandle{c});
+            if (a.getCurrentFloor() != b.getCurrentFloor() || a.getFloorsTravelled() != b.getFloorsTravelled()) {
+                return selfTestFailure(name, where + ": car " + to_string(c) + " differs");
+            }
+        }
+        // Trips that ended before the snapshot were only reported to the original
+        for (size_t i = 0; i < trace.size(); i++) {
+            if (originalTrips.getAlighted(i) <= snapshotAt) continue;
+            if (originalTrips.getAlighted(i) != restoredTrips.getAlighted(i) ||
+                (originalTrips.getBoarded(i) > snapshotAt &&
+                 originalTrips.getBoarded(i) != restoredTrips.getBoarded(i))) {
+                return selfTestFailure(name, where + ": trip " + to_string(i) + " differs");
+            }
+        }
+    }
+
+    // Damaged images must be refused before they touch the manager
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(image.data());
+    if (header->eventCount == 0 || header->assignmentCount == 0) {
+        return selfTestFailure(name, "the image has no events or assignments to corrupt");
+    }
+    const size_t assignmentsAt = image.size() - header->assignmentCount * sizeof(AssignmentSnapshot);
+    const size_t lastEventAt = assignmentsAt - sizeof(EventSnapshot);
+    auto refuses = [](vector<char> damaged) {
+        ElevatorManager manager;
+        return !manager.restoreSnapshot(damaged.data(), damaged.size());
+    };
+    vector<char> badMagic = image;
+    badMagic[0] = 'X';
+    vector<char> truncated(image.begin(), image.end() - 1);
+    vector<char> badFloor = image;
+    int32_t floor = MAX_FLOORS;
+    memcpy(badFloor.data() + lastEventAt + offsetof(EventSnapshot, floor), &floor, sizeof(floor));
+    vector<char> badCar = image;
+    int32_t car = cars;
+    memcpy(badCar.data() + assignmentsAt + offsetof(AssignmentSnapshot, car), &car, sizeof(car));
+    if (!refuses(badMagic)) return selfTestFailure(name, "accepted an image with a bad magic");
+    if (!refuses(truncated)) return selfTestFailure(name, "accepted a truncated image");
+    if (!refuses(badFloor)) return selfTestFailure(name, "accepted an event past the top floor");
+    if (!refuses(badCar)) return selfTestFailure(name, "accepted a hall call assigned to a missing car");
+    return SelfTestResult{name, true, ""};
+}
+
+// --self-test: runs every check and reports each
+int runSelfTest() {
+    Logger::setLevel(LogLevel::OFF);  // The simulators would log every call
+    vector<SelfTestResult> results;
+    results.push_back(checkEventLogRoundTrip());
+    results.push_back(checkElevatorSystemEquivalence());
+    results.push_back(checkSnapshotRoundTrip());
+    int failed = 0;
+    for (const SelfTestResult& result : results) {
+        printf("%-40s %s%s%s\n", result.name.c_str(), result.passed ? "PASS" : "FAIL",
+               result.detail.empty() ? "" : ": ", result.detail.c_str());
+        if (!result.passed) failed++;
+    }
+    printf("%zu checks, %d failed\n", results.size(), failed);
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    size_t workers = 0;
+    string replay, strategy, jsonPath;
+    bool microbench = false;
+    bool selfTest = false;
+    bool printMetrics = false;
+    size_t monteCarloRuns = 0;
+    string profile = "poisson";
+    vector<int> carCounts;
+    string recordLog, readLog, parking, saveSnapshotPath, resumePath;
+    int servePort = -1, pushPort = -1;
+    SimTime redispatch = 0, window = 0, failAt = -1;
+    double duration = 0.0;
+    int cars = 4, floors = 20, capacity = 0, failures = 0;
+    size_t calls = 2000;
+    SimTime meanGap = 3000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--quiet") Logger::setLevel(LogLevel::OFF);
+        else if (arg == "--workers" && hasValue) workers = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--replay" && hasValue) replay = argv[++i];
+        else if (arg == "--microbench") microbench = true;
+        else if (arg == "--self-test") selfTest = true;
+        else if (arg == "--metrics") printMetrics = true;
+        else if (arg == "--monte-carlo" && hasValue) monteCarloRuns = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--profile" && hasValue) profile = argv[++i];
+        else if (arg == "--cars-list" && hasValue) carCounts = parseIntList(argv[++i]);
+        else if (arg == "--record-log" && hasValue) recordLog = argv[++i];
+        else if (arg == "--read-log" && hasValue) readLog = argv[++i];
+        else if (arg == "--save-snapshot" && hasValue) saveSnapshotPath = argv[++i];
+        else if (arg == "--resume" && hasValue) resumePath = argv[++i];
+        else if (arg == "--serve" && hasValue) servePort = atoi(argv[++i]);
+        else if (arg == "--push" && hasValue) pushPort = atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) duration = atof(argv[++i]);
+        else if (arg == "--json" && hasValue) jsonPath = argv[++i];
+        else if (arg == "--strategy" && hasValue) strategy = argv[++i];
+        else if (arg == "--cars" && hasValue) cars = atoi(argv[++i]);
+        else if (arg == "--parking" && hasValue) parking = argv[++i];
+        else if (arg == "--redispatch" && hasValue) redispatch = atoll(argv[++i]);
+        else if (arg == "--window" && hasValue) window = atoll(argv[++i]);
+        else if (arg == "--fail" && hasValue) failures = atoi(argv[++i]);
+        else if (arg == "--fail-at" && hasValue) failAt = atoll(argv[++i]);
+        else if (arg == "--capacity" && hasValue) capacity = atoi(argv[++i]);
+        else if (arg == "--floors" && hasValue) floors = atoi(argv[++i]);
+        else if (arg == "--calls" && hasValue) calls = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--gap" && hasValue) meanGap = atoll(argv[++i]);
+        else if (arg == "--seed" && hasValue) seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+    }
+
+#if !ELEVATOR_METRICS
+    if (printMetrics) {
+        cerr << "--metrics needs a build with ELEVATOR_METRICS=1\n";
+        return 1;
+    }
+#endif
+    if (!readLog.empty()) return summarizeEventLog(readLog);
+    if (!resumePath.empty()) return resumeFromSnapshot(resumePath, workers);
+    if (servePort >= 0) return runIntakeServer(static_cast<uint16_t>(servePort), duration, max(cars, 1));
+    if (pushPort >= 0) return runIntakeClient(static_cast<uint16_t>(pushPort), calls, floors, seed);
+    if (microbench) return runMicrobenchmarkSuite(jsonPath);
+    if (selfTest) return runSelfTest();
+    if (monteCarloRuns > 0) {
+        if (carCounts.empty()) carCounts.push_back(cars);
+        return runMonteCarloMode(monteCarloRuns, profile, strategy, carCounts, capacity, floors, calls, meanGap, seed, workers);
+    }
+    if (!replay.empty()) {
+        ReplayOptions options;
+        options.cars = max(cars, 1);
+        options.capacity = capacity;
+        options.parking = parking;
+        options.redispatch = redispatch;
+        options.window = window;
+        options.failures = failures;
+        options.failAt = failAt;
+        return runReplayBenchmark(replay, strategy, options, floors, calls, meanGap, seed);
+    }
+
+    cout << "Starting Elevator System Simulation\n";
+    cout << "===================================\n\n";
+
+    // Create manager; it owns every car and panel it builds
+    unique_ptr<ElevatorManager> manager(new ElevatorManager());
+    EventLogWriter eventLog;
+    if (!recordLog.empty()) {
+        if (!eventLog.open(recordLog)) {
+            cerr << "Cannot write " << recordLog << "\n";
+            return 1;
+        }
+        manager->setEventLog(&eventLog);
+    }
+
+    // Create multiple elevators
+    manager->createElevators(2);
+
+    // Create panels for floors 1-3
+    PanelHandle firstPanel = manager->createPanels(1, 3);
+    OuterPanel* panel1 = &manager->getPanel(firstPanel);
+    OuterPanel* panel2 = &manager->getPanel(PanelHandle{firstPanel.index + 1});
+    OuterPanel* panel3 = &manager->getPanel(PanelHandle{firstPanel.index + 2});
+
+    cout << "\nSimulating elevator requests\n";
     cout << "===================================\n";
 
     // Simulate requests
     panel3->requestElevator(Direction::DOWN);  // Should select nearest elevator
     panel1->requestElevator(Direction::UP);    // Should select different elevator
     panel2->requestElevator(Direction::UP);    // Should select optimal elevator based on direction
+    manager->scheduleHallCall(9000, 1, Direction::UP); // Arrives while both cars are travelling
+    panel1->requestDestination(3);             // Destination dispatch: rides with the floor 3 stop
 
-    // Cleanup
-    delete manager;
-    delete elevator1;
-    delete elevator2;
-    delete panel1;
-    delete panel2;
-    delete panel3;
+    // A burst from the building gateway, including a repeated press
+    vector<HallCall> burst = {{2, Direction::DOWN}, {3, Direction::DOWN}, {2, Direction::DOWN}};
+    manager->addToQueueBatch(burst);
 
+    // A passenger already inside elevator 2 presses floor 3
+    manager->getInnerPanel(ElevatorHandle{1})->requestFloor(3);
+
+    if (!saveSnapshotPath.empty() && !manager->saveSnapshot(saveSnapshotPath)) {
+        cerr << "Cannot write " << saveSnapshotPath << "\n";
+        return 1;
+    }
+
+    // Advance the simulated clock until every car has served its queue
+    if (workers > 0) {
+        manager->runParallel(workers);
+    } else {
+        manager->run();
+    }
+    if (eventLog.isOpen()) {
+        manager->setEventLog(nullptr);
+        if (!eventLog.close()) {
+            cerr << "Cannot write " << recordLog << "\n";
+            return 1;
+        }
+    }
+
+#if ELEVATOR_METRICS
+    if (printMetrics) {
+        cout << "\n";
+        writePrometheus(cout, manager->getMetricsSnapshot());
+    }
+#endif
     return 0;
 }
\ No newline at end of file